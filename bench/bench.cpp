@@ -0,0 +1,311 @@
+#include <iostream>
+#include <sstream>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <chrono>
+#include <functional>
+#include <algorithm>
+#include <cstdlib>
+#include <cstdio>
+#include <cctype>
+#include <utility>
+
+#include <unistd.h>
+
+#include "toml.hpp"
+#include "cell.hpp"
+#include "row.hpp"
+#include "symbol.hpp"
+#include "table.hpp"
+#include "table_array.hpp"
+#include "formatter.hpp"
+#include "transaction_map.hpp"
+#include "autocomplete.hpp"
+#include "corpus.hpp"
+
+namespace {
+  constexpr int smallestCorpus = 1000;
+  constexpr int largestCorpus = 10000000;
+  // Fuzzy completion scans every account, so it is measured over a chart of
+  // accounts far larger than a corpus's
+  constexpr int candidateAccounts = 50000;
+  constexpr int candidateQueries = 1000;
+  constexpr int candidateLimit = 8; // As offered by the prompt
+  // Each benchmark is repeated until it has run for at least this long, and
+  // the fastest repetition is reported
+  constexpr std::chrono::milliseconds minimumDuration{200};
+  constexpr char const* globalDateFormat = "%Y-%m-%d";
+
+  // Results that are never used could be optimized away
+  volatile std::size_t sink;
+
+  // Tables and the autocomplete trie are read from files, so corpora are
+  // written out to temporary files for them
+  class TemporaryFile {
+  public:
+    TemporaryFile(std::string const& contents) {
+      char path[] = "/tmp/reconcile_benchXXXXXX";
+      int descriptor = mkstemp(path);
+      if (descriptor < 0) {
+	throw std::runtime_error("Error: Could not create a temporary file");
+      }
+      close(descriptor);
+      file = path;
+      std::ofstream out{file, std::ios::binary};
+      out << contents;
+    }
+    TemporaryFile(TemporaryFile const&) = delete;
+    ~TemporaryFile() { std::remove(file.c_str()); }
+    std::string const& path() const { return file; }
+  private:
+    std::string file;
+  };
+
+  struct Options {
+    int maxRows = largestCorpus;
+    std::string label; // Identifies the build, e.g., by commit
+    std::string only; // Runs only the named benchmark
+  };
+
+  class Runner {
+  public:
+    Runner(Options const& options) : options{options} {}
+
+    // Times body over a corpus of the given number of rows. Setup runs before
+    // each repetition, untimed, for benchmarks that consume their input
+    void run(std::string const& benchmark, int rows, std::function<void()>
+	body, std::function<void()> setup = [] {}) {
+      if (!options.only.empty() && options.only != benchmark) return;
+      using Clock = std::chrono::steady_clock;
+      Clock::duration fastest = Clock::duration::max();
+      Clock::duration total{0};
+      int iterations = 0;
+      while (total < minimumDuration) {
+	setup();
+	Clock::time_point start = Clock::now();
+	body();
+	Clock::duration elapsed = Clock::now() - start;
+	fastest = std::min(fastest, elapsed);
+	total += elapsed;
+	iterations++;
+      }
+
+      // One JSON object per line, so that results from different builds can
+      // be concatenated and compared
+      double seconds = std::chrono::duration<double>(fastest).count();
+      std::cout << "{\"label\":\"" << options.label << "\",";
+      std::cout << "\"benchmark\":\"" << benchmark << "\",";
+      std::cout << "\"rows\":" << rows << ",";
+      std::cout << "\"iterations\":" << iterations << ",";
+      std::cout << "\"seconds\":" << seconds << ",";
+      std::cout << "\"ns_per_row\":" << seconds * 1e9 / rows << "}\n";
+      std::cout.flush();
+    }
+  private:
+    Options options;
+  };
+
+  void benchmarkCorpus(Runner& runner, int rows) {
+    Corpus corpus{rows};
+    Descriptor const& descriptor = corpus.descriptor();
+
+    // Each stage's inputs are scoped to it, so that the largest corpora don't
+    // hold several copies of the statement at once
+    {
+      // Cells as they are found in the statement
+      std::vector<std::string> amounts;
+      std::vector<std::string> dates;
+      for (auto const& line : corpus.lines()) {
+	std::vector<std::string> cells;
+	std::stringstream stream{line};
+	std::string cell;
+	while (std::getline(stream, cell, ',')) cells.push_back(cell);
+	dates.push_back(cells[descriptor.dateColumn]);
+	amounts.push_back(cells[descriptor.debitColumn]);
+      }
+
+      runner.run("cell_parse_amount", rows, [&] {
+	Amount total = 0;
+	for (auto const& amount : amounts) {
+	  total += Cell{amount}.as<Amount>(descriptor.debitFormat);
+	}
+	sink = total;
+      });
+      runner.run("cell_parse_date", rows, [&] {
+	unsigned total = 0;
+	for (auto const& date : dates) {
+	  auto parsed = Cell{date}.as<std::chrono::year_month_day>(
+	      descriptor.dateFormat);
+	  total += static_cast<unsigned>(parsed.day());
+	}
+	sink = total;
+      });
+      std::vector<Amount> values;
+      for (auto const& amount : amounts) {
+	values.push_back(Cell{amount}.as<Amount>(descriptor.debitFormat));
+      }
+      runner.run("cell_format_amount", rows, [&] {
+	std::size_t total = 0;
+	for (Amount value : values) {
+	  total += Cell{value}.as<std::string>(descriptor.debitFormat).size();
+	}
+	sink = total;
+      });
+    }
+
+    Row::Metadata metadata = {.sortColumn = descriptor.dateColumn};
+    runner.run("row_construct", rows, [&] {
+      std::size_t total = 0;
+      for (auto const& line : corpus.lines()) {
+	total += Row{line + ',', metadata}.size();
+      }
+      sink = total;
+    });
+
+    // Tables are read from the file from here on
+    TemporaryFile statement{corpus.text()};
+    corpus.release();
+    runner.run("table_construct", rows, [&] {
+      Table table{statement.path(), globalDateFormat, descriptor};
+      sink = table.length();
+    });
+
+    {
+      // A single table is sorted, reloaded before every repetition but the
+      // first, and then kept for the formatter
+      Table table{statement.path(), globalDateFormat, descriptor};
+      bool sorted = false;
+      runner.run("table_sort", rows, [&] {
+	std::sort(++table.begin(), table.end());
+      }, [&] {
+	if (sorted) {
+	  table = Table{statement.path(), globalDateFormat, descriptor};
+	}
+	sorted = true;
+      });
+      // The table is unsorted if table_sort was skipped
+      std::sort(++table.begin(), table.end());
+
+      // Categorize every row as its payee would be, then write the ledger
+      std::unordered_map<std::string_view, int> payeeIndices;
+      for (int i = 0; i < corpus.payees().size(); i++) {
+	payeeIndices[corpus.payees()[i]] = i;
+      }
+      for (auto row = table.begin() + 1; row != table.end(); row++) {
+	int payee = payeeIndices[table.getPayee(row).str()];
+	table.setCounterparty(row, Symbol{corpus.account(payee)});
+      }
+      TableArray tables;
+      tables.push_back(std::move(table));
+      toml::table format{
+	{"locale", "C"},
+	{"indentation", 4},
+	{"margin", 8}
+      };
+      runner.run("formatter", rows, [&] {
+	std::ostringstream out;
+	out << Formatter{tables, format};
+	sink = out.str().size();
+      });
+    }
+
+    TransactionMap transactionMap;
+    std::vector<Symbol> payees;
+    for (int payee : corpus.rowPayees()) {
+      payees.emplace_back(corpus.payees()[payee]);
+      transactionMap.addRelation(payees.back(),
+	  Symbol{corpus.account(payee)});
+    }
+    runner.run("transaction_map_lookup", rows, [&] {
+      std::size_t total = 0;
+      for (Symbol payee : payees) {
+	total += transactionMap.getCounterparty(payee).id();
+      }
+      sink = total;
+    });
+
+    // Complete a prefix of the account each row's payee would be categorized
+    // as, cut at varying lengths
+    std::string journal;
+    for (auto const& account : corpus.accounts()) {
+      journal += "account " + account + '\n';
+    }
+    TemporaryFile accounts{journal};
+    Autocomplete autocomplete{accounts.path()};
+    std::vector<std::string> prefixes;
+    for (int i = 0; i < rows; i++) {
+      std::string const& account = corpus.account(corpus.rowPayees()[i]);
+      prefixes.push_back(account.substr(0, 1 + i % account.size()));
+    }
+    runner.run("autocomplete_complete", rows, [&] {
+      std::size_t total = 0;
+      for (auto const& prefix : prefixes) {
+	total += autocomplete.complete(prefix).size();
+      }
+      sink = total;
+    });
+  }
+
+  void benchmarkCandidates(Runner& runner) {
+    Corpus corpus{Corpus::Options{.accounts = candidateAccounts}};
+    std::string journal;
+    for (auto const& account : corpus.accounts()) {
+      journal += "account " + account + '\n';
+    }
+    TemporaryFile accounts{journal};
+    Autocomplete autocomplete{accounts.path()};
+
+    // Queries are lowercase subsequences of accounts, as typed when only a
+    // few letters of an account are remembered
+    std::vector<std::string> queries;
+    for (int i = 0; i < candidateQueries; i++) {
+      std::string const& account = corpus.accounts()[i * 7919 %
+	  candidateAccounts];
+      std::string query;
+      for (std::size_t j = i % 3; j < account.size() && query.size() < 4;
+	  j += 3) {
+	query += std::tolower(static_cast<unsigned char>(account[j]));
+      }
+      queries.push_back(query);
+    }
+    runner.run("autocomplete_candidates", candidateQueries, [&] {
+      std::size_t total = 0;
+      for (auto const& query : queries) {
+	total += autocomplete.candidates(query, candidateLimit).size();
+      }
+      sink = total;
+    });
+  }
+}
+
+int main(int argc, char* argv[]) {
+  Options options;
+  for (int i = 1; i < argc; i++) {
+    std::string_view option{argv[i]};
+    if (option == "--max-rows" && i + 1 < argc) {
+      options.maxRows = std::atoi(argv[++i]);
+    } else if (option == "--label" && i + 1 < argc) {
+      options.label = argv[++i];
+    } else if (option == "--only" && i + 1 < argc) {
+      options.only = argv[++i];
+    } else {
+      std::cerr << "Usage: reconcile.bench [--max-rows rows] [--label label] ";
+      std::cerr << "[--only benchmark]\n";
+      return 1;
+    }
+  }
+
+  // Corpora grow tenfold from one size to the next
+  Runner runner{options};
+  for (int rows = smallestCorpus; rows <= options.maxRows; rows *= 10) {
+    std::cerr << "Info: Benchmarking a corpus of " << rows << " rows\n";
+    benchmarkCorpus(runner, rows);
+    if (rows > options.maxRows / 10) break; // Avoids overflowing
+  }
+  std::cerr << "Info: Benchmarking " << candidateAccounts << " accounts\n";
+  benchmarkCandidates(runner);
+  return 0;
+}
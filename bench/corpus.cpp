@@ -0,0 +1,240 @@
+#include "corpus.hpp"
+
+namespace {
+  constexpr int payeeCount = 2000;
+  constexpr char const* syllables[] = {
+    "KA", "RO", "MEX", "TIN", "LO", "VA", "SHE", "PAR", "DO", "BEL", "QUI",
+    "NOR", "FI", "ZAN", "TRO", "MU"
+  };
+  constexpr char const* accountParents[] = {
+    "Expenses", "Expenses:Food", "Expenses:Travel", "Expenses:Home", "Income",
+    "Liabilities"
+  };
+  constexpr int debitPercentage = 15; // Of chequing rows, the rest are credits
+  constexpr int incorporatedEvery = 5; // Quoted payees with a comma in them
+  // Of savings statements, in cents
+  constexpr std::int64_t openingBalance = 500000;
+
+  struct StatementFormat {
+    char const* preamble; // Must not contain a comma (see Table)
+    char const* header;
+    Descriptor descriptor;
+  };
+
+  // The first two mirror the sample statements and config
+  StatementFormat const formats[] = {
+    {
+      "XXXXXXXXXXXXXXX1",
+      "Account Type,Transaction Date,Cheque Number,Description 1,"
+	  "Description 2,CAD$,USD$",
+      {
+	.identifier = "XXXXXXXXXXXXXXX1",
+	.ledgerSource = "Assets:Chequing",
+	.normalBalance = Descriptor::DEBIT,
+	.dateColumn = 1,
+	.debitColumn = 5,
+	.creditColumn = 5,
+	.dateFormat = "%m/%d/%Y",
+	.debitFormat = "{:.2f}",
+	.creditFormat = "{:.2f}",
+	.payeeColumns = {3, 4},
+	.displayColumns = {1, 5, 3, 4}
+      }
+    },
+    {
+      "Following data is valid as of 20240622195022:",
+      "Item #,Card #,Transaction Date,Posting Date,Transaction Amount,"
+	  "Description",
+      {
+	.identifier = "XXXXXXXXXXXXXXX2",
+	.ledgerSource = "Liabilities:Credit Card",
+	.normalBalance = Descriptor::CREDIT,
+	.dateColumn = 2,
+	.debitColumn = 4,
+	.creditColumn = 4,
+	.dateFormat = "%Y%m%d",
+	.debitFormat = "{:.2f}",
+	.creditFormat = "{:.2f}",
+	.payeeColumns = {5},
+	.displayColumns = {2, 4, 5}
+      }
+    },
+    {
+      "Savings account XXXXXXXXXXXXXXX3",
+      "Date,Description,Withdrawals,Deposits,Balance",
+      {
+	.identifier = "XXXXXXXXXXXXXXX3",
+	.ledgerSource = "Assets:Savings",
+	.normalBalance = Descriptor::DEBIT,
+	.dateColumn = 0,
+	.debitColumn = 3,
+	.creditColumn = 2,
+	.dateFormat = "%Y-%m-%d",
+	.debitFormat = "{:.2f}",
+	.creditFormat = "{:.2f}",
+	.payeeColumns = {1},
+	.displayColumns = {0, 2, 3, 1}
+      }
+    }
+  };
+
+  std::string field(std::string const& value, bool quoted) {
+    return quoted ? '"' + value + '"' : value;
+  }
+}
+
+Corpus::Corpus(Options const& options) {
+  StatementFormat const& format = formats[options.layout];
+  statementDescriptor = format.descriptor;
+
+  // Statements of every layout generated with the same seed share their
+  // payees and accounts, so they can make up a single session
+  std::mt19937 vocabulary{options.seed};
+  for (int i = 0; i < options.accounts; i++) {
+    std::uniform_int_distribution<int> parent{0, std::size(accountParents) -
+      1};
+    std::string account = accountParents[parent(vocabulary)];
+    account += ":" + name(vocabulary, 2);
+    accountNames.push_back(account + " " + std::to_string(i));
+  }
+  std::uniform_int_distribution<int> anyAccount{0, options.accounts - 1};
+  for (int i = 0; i < payeeCount; i++) {
+    std::string payee = name(vocabulary, 3) + " " + std::to_string(i);
+    if (options.quoted && i % incorporatedEvery == 0) payee += ", INC";
+    payeeNames.push_back(payee);
+    payeeAccounts.push_back(anyAccount(vocabulary));
+  }
+
+  // The payee of rank k (counting from one) is drawn with probability
+  // proportional to 1 / k^s. Drawing inverts the cumulative distribution
+  std::vector<double> cumulative;
+  double total = 0;
+  for (int k = 1; k <= payeeCount; k++) {
+    total += 1 / std::pow(k, options.zipfExponent);
+    cumulative.push_back(total);
+  }
+  std::uniform_real_distribution<double> anyWeight{0, total};
+
+  // Rows are spread over (by default, at least) a year of dates, in no
+  // particular order, so that loading the statement involves a real sort
+  std::mt19937 random{options.seed + 1 + options.layout};
+  int days = options.days > 0 ? options.days : std::max(365, options.rows /
+      20);
+  std::uniform_int_distribution<int> anyDay{0, days - 1};
+  std::uniform_int_distribution<int> anyCents{100, 50000};
+  std::uniform_int_distribution<int> percentage{0, 99};
+  std::chrono::sys_days start{options.firstDate};
+  char const* ending = options.crlf ? "\r\n" : "\n";
+
+  statement = std::string{format.preamble} + ending + format.header + ending;
+  statementLines.reserve(options.rows);
+  payeeIndices.reserve(options.rows);
+  std::int64_t balance = openingBalance;
+  char date[16];
+  for (int row = 0; row < options.rows; row++) {
+    std::chrono::year_month_day day{start + std::chrono::days{anyDay(random)}};
+    int year = static_cast<int>(day.year());
+    unsigned month = static_cast<unsigned>(day.month());
+    unsigned dayOfMonth = static_cast<unsigned>(day.day());
+    int payee = std::upper_bound(cumulative.begin(), cumulative.end() - 1,
+	anyWeight(random)) - cumulative.begin();
+    std::string payeeField = field(payeeNames[payee], options.quoted);
+    int cents = anyCents(random);
+    // Chequing and savings rows are mostly withdrawals and credit card rows
+    // mostly purchases
+    bool debit = percentage(random) < debitPercentage;
+    if (options.layout == CREDIT_CARD ? debit : !debit) cents = -cents;
+
+    std::string line;
+    switch (options.layout) {
+      case CHEQUING:
+	std::snprintf(date, sizeof(date), "%u/%u/%d", month, dayOfMonth, year);
+	line = std::string{"Chequing,"} + date + ",," + payeeField + ",," +
+	    amount(cents) + ",";
+	break;
+      case CREDIT_CARD:
+	std::snprintf(date, sizeof(date), "%d%02u%02u", year, month,
+	    dayOfMonth);
+	line = std::to_string(row + 1) + ",'XXXXXXXXXXXXXXX2'," + date + "," +
+	    date + "," + amount(cents) + "," + payeeField;
+	break;
+      default:
+	// Withdrawals keep their sign, since Table reads the sign of an amount
+	// from the amount itself rather than from its column
+	std::snprintf(date, sizeof(date), "%d-%02u-%02u", year, month,
+	    dayOfMonth);
+	balance += cents;
+	line = std::string{date} + "," + payeeField + "," +
+	    (cents < 0 ? amount(cents) : "") + "," +
+	    (cents >= 0 ? amount(cents) : "") + "," + amount(balance);
+	break;
+    }
+    statement += line;
+    statement += ending;
+    statementLines.push_back(std::move(line));
+    payeeIndices.push_back(payee);
+  }
+}
+
+Corpus::Corpus(int rows, Layout layout, std::uint32_t seed) :
+    Corpus{Options{.rows = rows, .layout = layout, .seed = seed}} {}
+
+std::string const& Corpus::text() const { return statement; }
+
+std::vector<std::string> const& Corpus::lines() const {
+  return statementLines;
+}
+
+void Corpus::release() {
+  statement = std::string{};
+  statementLines = std::vector<std::string>{};
+}
+
+Descriptor const& Corpus::descriptor() const { return statementDescriptor; }
+
+std::vector<std::string> const& Corpus::payees() const { return payeeNames; }
+
+std::vector<std::string> const& Corpus::accounts() const {
+  return accountNames;
+}
+
+std::string const& Corpus::account(int payee) const {
+  return accountNames[payeeAccounts[payee]];
+}
+
+std::vector<int> const& Corpus::rowPayees() const { return payeeIndices; }
+
+void Corpus::write(std::string const& file) const {
+  std::ofstream out{file, std::ios::binary};
+  out << statement;
+  out.close();
+  if (out.fail()) throw std::runtime_error("Error: Could not write " + file);
+}
+
+std::string Corpus::layoutName(Layout layout) {
+  switch (layout) {
+    case CHEQUING:
+      return "chequing";
+    case CREDIT_CARD:
+      return "credit_card";
+    default:
+      return "savings";
+  }
+}
+
+std::string Corpus::name(std::mt19937& random, int syllableCount) {
+  std::uniform_int_distribution<int> anySyllable{0, std::size(syllables) - 1};
+  std::string result;
+  for (int i = 0; i < syllableCount; i++) {
+    result += syllables[anySyllable(random)];
+  }
+  return result;
+}
+
+std::string Corpus::amount(std::int64_t cents) {
+  char formatted[32];
+  long long magnitude = std::llabs(cents);
+  std::snprintf(formatted, sizeof(formatted), "%s%lld.%02lld",
+      cents < 0 ? "-" : "", magnitude / 100, magnitude % 100);
+  return formatted;
+}
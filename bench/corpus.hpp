@@ -0,0 +1,74 @@
+#ifndef CORPUS_H
+#define CORPUS_H
+
+#include <string>
+#include <vector>
+#include <random>
+#include <fstream>
+#include <cstdint>
+#include <cstdio>
+#include <cmath>
+#include <stdexcept>
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
+#include <iterator>
+
+#include "statement_importer.hpp"
+
+// A synthetic statement in the layout of one of a few real bank statements,
+// along with the descriptor for reading it and the payees and ledger accounts
+// its rows are drawn from. Payees are drawn from a Zipf distribution, so a few
+// payees make up most rows, as they do in practice. Generation is seeded, so a
+// corpus of given options is the same from run to run (and from commit to
+// commit)
+class Corpus {
+public:
+  // The sample chequing and credit card statements have a single amount
+  // column. Savings statements have separate withdrawal and deposit columns
+  enum Layout {CHEQUING, CREDIT_CARD, SAVINGS, LAYOUT_COUNT};
+  struct Options {
+    int rows = 1000;
+    Layout layout = CHEQUING;
+    std::uint32_t seed = 1;
+    double zipfExponent = 1.0; // Zero draws payees uniformly
+    std::chrono::year_month_day firstDate = std::chrono::year{2020} /
+	std::chrono::January / 1;
+    int days = 0; // Over which rows are dated. Zero scales with the rows
+    bool quoted = false; // Quote payees, some of which then contain commas
+    bool crlf = false; // End lines with CRLF rather than LF
+    int accounts = 200; // Ledger accounts payees are categorized as
+  };
+  Corpus(Options const& options);
+  Corpus(int rows, Layout layout = CHEQUING, std::uint32_t seed = 1);
+  // The statement's CSV text, including the lines preceding its header
+  std::string const& text() const;
+  // The statement's rows, without line endings
+  std::vector<std::string> const& lines() const;
+  // Frees the text and lines, e.g., once the statement has been written to
+  // file. Both are empty afterwards
+  void release();
+  Descriptor const& descriptor() const;
+  std::vector<std::string> const& payees() const;
+  std::vector<std::string> const& accounts() const;
+  // The ledger account each payee would be categorized as
+  std::string const& account(int payee) const;
+  // Index of the payee of each row
+  std::vector<int> const& rowPayees() const;
+  // Writes the statement to file
+  void write(std::string const& file) const;
+  // Lowercase name of a layout, e.g., for file names
+  static std::string layoutName(Layout layout);
+private:
+  std::string statement;
+  std::vector<std::string> statementLines;
+  Descriptor statementDescriptor;
+  std::vector<std::string> payeeNames;
+  std::vector<std::string> accountNames;
+  std::vector<int> payeeAccounts;
+  std::vector<int> payeeIndices;
+  static std::string name(std::mt19937& random, int syllables);
+  static std::string amount(std::int64_t cents);
+};
+
+#endif
@@ -1,153 +1,870 @@
 #include "autocomplete.hpp"
 
-Autocomplete::Autocomplete(std::string accounts) {
-  // Open accounts file
-  std::ifstream inputStream{accounts};
-  if (!inputStream.is_open()) {
-    throw std::runtime_error("Error: Could not open file " + accounts);
+namespace {
+  constexpr char magic[8] = {'R', 'C', 'N', 'T', 'R', 'I', 'E', '\0'};
+  constexpr std::uint32_t version = 3;
+  constexpr std::uint64_t sectionAlignment = 8;
+  constexpr std::string temporarySuffix = ".tmp";
+
+  // Round offset up to the next multiple of alignment
+  std::uint64_t align(std::uint64_t offset, std::uint64_t alignment) {
+    return (offset + alignment - 1) / alignment * alignment;
   }
 
-  // Step through each line of the file and parse account names
-  std::string line;
-  while (std::getline(inputStream, line)) {
-    std::smatch matches;
-    std::regex expression{"^account (.*)", std::regex::extended};
+  char fold(char c) { return ('A' <= c && c <= 'Z') ? c - 'A' + 'a' : c; }
 
-    if (std::regex_search(line, matches, expression)) {
-      // Insert into radix trie
-      insert(matches[1]);
-    }
+  bool isBoundary(char c) { return c == ':' || c == ' ' || c == '-'; }
+
+  constexpr int noMatch = std::numeric_limits<int>::min();
+
+  // Scoring weights, loosely following those of fzf
+  namespace Score {
+    constexpr int match = 16;
+    constexpr int boundary = 8; // Match at the start of a name or segment
+    constexpr int consecutive = 4;
+    constexpr int gapStart = -3;
+    constexpr int gapExtension = -1;
   }
 }
 
-std::string Autocomplete::complete(std::string partial) {
+Autocomplete::Autocomplete(std::string accounts, std::string snapshotFile) :
+    snapshotFile{snapshotFile} {
+  MemoryStats::Tag tag{MemoryStats::AUTOCOMPLETE};
+  if (!snapshotFile.empty() && load(accounts)) return;
+
+  // Harvest account names from the journal (and any journals it includes),
+  // then load them into the radix trie in a single pass
+  JournalScanner scanner{accounts};
+  sourceFiles = scanner.files();
+  sourcePatterns = scanner.patterns();
+  build(scanner.accounts());
+  if (!snapshotFile.empty()) save();
+}
+
+std::string Autocomplete::complete(std::string partial) const {
+  // If the partial string stops part way through a node's label, then complete
+  // the rest of that label
+  std::uint32_t node;
+  std::string_view rest;
+  if (!locate(partial, node, rest)) return partial;
   std::string completed = partial;
+  completed.append(rest);
+
+  // Follow the chain of single child nodes until we hit a fork, adding each
+  // single child node's label along the way
+  while (nodes[node].childCount == 1) {
+    node = nodes[node].firstChild;
+    completed.append(label(node));
+  }
+
+  return completed;
+}
+
+std::vector<std::string> Autocomplete::candidates(std::string_view query,
+    int limit) const {
+  std::vector<std::string> result;
+  if (accounts.empty() || query.empty() || limit <= 0) return result;
+
+  std::string foldedQuery{query};
+  for (char& c : foldedQuery) c = fold(c);
+
+  // An account can only match if it contains every character of the query, so
+  // test each account's character bitset first. This loop over a contiguous
+  // array of integers is branch-free and is vectorized by the compiler,
+  // eliminating the vast majority of accounts before any strings are examined
+  std::uint64_t queryMask = mask(foldedQuery);
+  std::vector<std::uint8_t> possible(masks.size());
+  for (std::size_t i = 0; i < masks.size(); i++) {
+    possible[i] = (masks[i] & queryMask) == queryMask;
+  }
+
+  struct Match {
+    int score;
+    std::uint32_t index;
+  };
+  std::vector<Match> matches;
+  for (std::uint32_t i = 0; i < possible.size(); i++) {
+    if (!possible[i]) continue;
+    Account const& account = accounts[i];
+    std::string_view name = folded.substr(account.offset, account.length);
+    int accountScore = score(foldedQuery, name);
+    if (accountScore != noMatch) matches.push_back({accountScore, i});
+  }
+
+  // Rank by score, then prefer shorter (i.e., less specific) accounts. Since
+  // the accounts are sorted, falling back on their indices keeps the ranking
+  // alphabetical otherwise
+  int count = std::min<std::size_t>(limit, matches.size());
+  auto compare = [this](Match const& a, Match const& b) {
+    if (a.score != b.score) return a.score > b.score;
+    std::uint32_t lengthA = accounts[a.index].length;
+    std::uint32_t lengthB = accounts[b.index].length;
+    if (lengthA != lengthB) return lengthA < lengthB;
+    return a.index < b.index;
+  };
+  std::partial_sort(matches.begin(), matches.begin() + count, matches.end(),
+      compare);
+  for (int i = 0; i < count; i++) {
+    Account const& account = accounts[matches[i].index];
+    result.emplace_back(text.substr(account.offset, account.length));
+  }
+  return result;
+}
+
+std::vector<std::string> Autocomplete::frequent(std::string_view prefix)
+    const {
+  std::vector<std::string> result;
+  std::uint32_t node;
+  std::string_view rest;
+  if (!locate(prefix, node, rest)) return result;
+  // The accounts beginning with the prefix are exactly those beneath the node
+  // that the prefix ends in, so its ranking is the answer
+  for (Ranked const& entry : ranking(node)) {
+    if (entry.count == 0) break;
+    result.emplace_back(text.substr(entry.offset, entry.length));
+  }
+  return result;
+}
+
+void Autocomplete::use(std::string_view name, std::int64_t count) {
+  auto position = find(name);
+  if (position == accounts.end() ||
+      text.substr(position->offset, position->length) != name) {
+    return;
+  }
+  for (auto& account : added) {
+    if (account.name == name) account.uses += count;
+  }
+  std::int64_t& total = usage[position->offset];
+  total = std::max<std::int64_t>(total + count, 0);
+  Ranked entry = {position->offset, position->length, total};
+
+  // Only the rankings along the account's path can include it. Lowering a
+  // count can leave the account last in a ranking that an unranked account
+  // now deserves a place in, so such a ranking is rebuilt
+  if (rankings.size() < nodes.size()) rankings.resize(nodes.size());
+  auto update = [&](std::uint32_t node, std::size_t depth) {
+    rank(node, entry);
+    if (count < 0 && rankings[node].back().offset == entry.offset) {
+      rerank(node, name.substr(0, depth));
+    }
+  };
+  std::uint32_t node = 0;
+  std::size_t depth = 0;
+  update(node, depth);
+  while (depth < name.size()) {
+    node = child(node, name[depth]);
+    depth += nodes[node].labelLength;
+    update(node, depth);
+  }
+}
+
+int Autocomplete::score(std::string_view query, std::string_view name) const {
+  // Find the end of the earliest occurrence of the query as a subsequence of
+  // the name. Each step is a memchr, which the C library vectorizes
+  std::size_t end = 0;
+  for (char c : query) {
+    void const* found = std::memchr(name.data() + end, c, name.size() - end);
+    if (found == nullptr) return noMatch;
+    end = static_cast<char const*>(found) - name.data() + 1;
+  }
+
+  // Then walk backwards from that end to find the latest start, giving the
+  // shortest window of the name containing the query
+  std::size_t start = end;
+  for (std::size_t q = query.size(); q > 0; start--) {
+    if (name[start - 1] == query[q - 1]) q--;
+  }
+
+  // Score the matches within the window, rewarding matches at the start of
+  // account segments and runs of consecutive matches while penalizing gaps
+  int total = 0;
+  std::size_t q = 0;
+  bool previousMatched = false;
+  bool inGap = false;
+  for (std::size_t i = start; i < end; i++) {
+    if (q < query.size() && name[i] == query[q]) {
+      total += Score::match;
+      if (i == 0 || isBoundary(name[i - 1])) {
+	// The first character of the query landing on a boundary is the
+	// strongest signal of intent
+	total += q == 0 ? 2 * Score::boundary : Score::boundary;
+      } else if (previousMatched) {
+	total += Score::consecutive;
+      }
+      previousMatched = true;
+      inGap = false;
+      q++;
+    } else {
+      total += inGap ? Score::gapExtension : Score::gapStart;
+      previousMatched = false;
+      inGap = true;
+    }
+  }
+  return total;
+}
+
+bool Autocomplete::insert(std::string_view name) {
+  MemoryStats::Tag tag{MemoryStats::AUTOCOMPLETE};
+  if (name.empty()) return false;
 
-  int charactersFound;
-  Node* node = nullptr;
-  bool completeMatch = search(partial, node, charactersFound);
-  std::string remaining = partial.substr(charactersFound);
-
-  // Determine which child node under the closest partially matching parent node
-  // to traverse from
-  if (!completeMatch) {
-    for (Node& child : node->children) {
-      if (child.value.starts_with(remaining)) {
-	// Don't add any overlapping characters between the remaining string and
-	// the child value to the completion string (they already exist in the
-	// completion string since it is seeded with the partial string)
-	completed += child.value.substr(remaining.size());
-	node = &child;
-	break;
+  // Accounts are kept sorted, so a binary search both determines whether the
+  // account is new and where it belongs
+  auto position = find(name);
+  if (position != accounts.end() &&
+      text.substr(position->offset, position->length) == name) {
+    return false;
+  }
+  std::size_t index = position - accounts.begin();
+
+  // A mapped snapshot is read-only, so take a copy of it before modifying it
+  own();
+
+  // Append the name to the text arenas; the labels of any new nodes will refer
+  // to substrings of it
+  std::uint32_t offset = textStorage.size();
+  std::uint32_t length = name.size();
+  textStorage.insert(textStorage.end(), name.begin(), name.end());
+  for (char c : name) foldedStorage.push_back(fold(c));
+  accountStorage.insert(accountStorage.begin() + index, {offset, length});
+  maskStorage.insert(maskStorage.begin() + index,
+      mask({foldedStorage.data() + offset, length}));
+  viewStorage();
+
+  // Descend through the nodes whose labels are spelled out by the name
+  std::uint32_t node = 0;
+  std::uint32_t depth = 0;
+  while (depth < length) {
+    std::uint32_t next = child(node, name[depth]);
+    Node leaf = {
+      .label = offset + depth,
+      .labelLength = static_cast<std::uint16_t>(length - depth),
+      .terminal = true
+    };
+
+    if (next == 0) {
+      // No child shares the next character, so the remainder of the name
+      // becomes a new child alongside the node's existing children
+      std::vector<Child> children;
+      Node const& parent = nodeStorage[node];
+      for (std::uint32_t i = 0; i < parent.childCount; i++) {
+	std::uint32_t sibling = parent.firstChild + i;
+	children.push_back({keyStorage[sibling], nodeStorage[sibling],
+	    ranking(sibling)});
       }
+      children.push_back({name[depth], leaf});
+      appendChildren(node, std::move(children));
+      break;
+    }
+
+    // Count the number of consecutive characters that are common between the
+    // child's label and the remainder of the name
+    std::string_view nextLabel = label(next);
+    std::string_view remaining = name.substr(depth);
+    std::uint16_t common = std::mismatch(nextLabel.begin(), nextLabel.end(),
+	remaining.begin(), remaining.end()).first - nextLabel.begin();
+
+    if (common == nextLabel.size()) {
+      node = next;
+      depth += common;
+      continue;
     }
+
+    // Split the child so that its label is the common prefix, moving the rest
+    // of its label (along with its children) into a new suffix node. Unless the
+    // name ends at the split (as would occur when inserting e.g., "tea" after
+    // "team"), the remainder of the name becomes the suffix node's sibling.
+    // The suffix node has the same accounts beneath it as the child did, and
+    // the new account is yet to be used, so both keep the child's ranking
+    Node suffix = nodeStorage[next];
+    suffix.label += common;
+    suffix.labelLength -= common;
+    std::vector<Child> children{{nextLabel[common], suffix, ranking(next)}};
+    bool endsAtSplit = depth + common == length;
+    if (!endsAtSplit) {
+      leaf.label += common;
+      leaf.labelLength -= common;
+      children.push_back({name[depth + common], leaf});
+    }
+
+    nodeStorage[next].labelLength = common;
+    nodeStorage[next].terminal = endsAtSplit;
+    appendChildren(next, std::move(children));
+    break;
   }
+  // The name may also end exactly at an existing node
+  if (depth == length) nodeStorage[node].terminal = true;
 
-  // Follow the chain of single child nodes until we hit a fork, adding each
-  // single child node's value along the way
-  while (node->numberOfChildren == 1) {
-    node = &(node->children.front());
-    completed += node->value;
+  viewStorage();
+  added.push_back({std::string{name}});
+  return true;
+}
+
+void Autocomplete::writeAdded() {
+  if (sourceFiles.empty()) return;
+  std::vector<std::string_view> used;
+  for (auto const& account : added) {
+    if (account.uses > 0) used.push_back(account.name);
   }
+  // Accounts that were taken back are still in the trie, so it only matches
+  // the journal if every added account is written
+  bool complete = used.size() == added.size();
+  if (used.empty()) {
+    added.clear();
+    return;
+  }
+  std::string const& journal = sourceFiles.front();
 
-  return completed;
+  int descriptor = open(journal.c_str(), O_RDWR | O_APPEND);
+  if (descriptor < 0) return;
+
+  // Batch all of the directives into a single write, making sure that the
+  // first of them starts on a new line
+  std::string directives;
+  struct stat status;
+  char last = '\n';
+  if (fstat(descriptor, &status) == 0 && status.st_size > 0) {
+    pread(descriptor, &last, 1, status.st_size - 1);
+  }
+  if (last != '\n') directives.push_back('\n');
+  for (std::string_view name : used) {
+    directives.append("account ").append(name).push_back('\n');
+  }
+  bool written = write(descriptor, directives.data(), directives.size()) ==
+      static_cast<ssize_t>(directives.size());
+  close(descriptor);
+  added.clear();
+
+  // The trie now holds exactly the accounts that a rescan of the journal would
+  // find, so re-save the snapshot against the journal's new fingerprint rather
+  // than letting the next run discard it and rebuild
+  if (written && complete && !snapshotFile.empty()) save();
+}
+
+std::uint32_t Autocomplete::child(std::uint32_t node, char key) const {
+  // The first character of each child node's label is guaranteed to be unique
+  // from all other child nodes (this first character is the radix of the
+  // trie). Since the root is never a child, zero denotes that there is no
+  // child for the given key
+  Node const& parent = nodes[node];
+  char const* first = keys.data() + parent.firstChild;
+  void const* found = std::memchr(first, key, parent.childCount);
+  if (found == nullptr) return 0;
+  return static_cast<char const*>(found) - keys.data();
+}
+
+std::string_view Autocomplete::label(std::uint32_t node) const {
+  return std::string_view{text}.substr(nodes[node].label,
+      nodes[node].labelLength);
+}
+
+bool Autocomplete::locate(std::string_view prefix, std::uint32_t& node,
+    std::string_view& rest) const {
+  if (nodes.empty()) return false;
+
+  // Descend through the nodes whose labels are spelled out by the prefix. If
+  // the prefix stops part way through a node's label, then that node is where
+  // it ends, and the rest of the label is left over
+  node = 0;
+  rest = {};
+  while (!prefix.empty()) {
+    std::uint32_t next = child(node, prefix.front());
+    if (next == 0) return false; // No account begins with the prefix
+
+    std::string_view nextLabel = label(next);
+    if (prefix.size() < nextLabel.size()) {
+      if (!nextLabel.starts_with(prefix)) return false;
+      rest = nextLabel.substr(prefix.size());
+      prefix = {};
+    } else {
+      if (!prefix.starts_with(nextLabel)) return false;
+      prefix.remove_prefix(nextLabel.size());
+    }
+    node = next;
+  }
+  return true;
 }
 
-bool Autocomplete::search(std::string value, Node*& result, int&
-    charactersFound) {
-  Node* currentNode = &root;
-  charactersFound = 0;
+std::span<Autocomplete::Account const>::iterator Autocomplete::find(
+    std::string_view name) const {
+  // Accounts are kept sorted, so the first account not less than the name is
+  // either the name itself or where it belongs
+  return std::lower_bound(accounts.begin(), accounts.end(), name,
+      [this](Account const& account, std::string_view name) {
+	return text.substr(account.offset, account.length) < name;
+      });
+}
 
-  while (currentNode != nullptr && charactersFound < value.size()) {
-    Node* next = nullptr;
+Autocomplete::Ranking Autocomplete::ranking(std::uint32_t node) const {
+  if (node < rankings.size()) return rankings[node];
+  return {};
+}
 
-    // Determine the next node to traverse by evaluating which child node's
-    // value forms the prefix of the sub-string of value not yet found in the
-    // trie
-    for (Node& child : currentNode->children) {
-      std::string remaining = value.substr(charactersFound);
-      
-      if (remaining.starts_with(child.value)) next = &child;
+void Autocomplete::rank(std::uint32_t node, Ranked entry) {
+  Ranking& ranking = rankings[node];
+  // Update the account's entry if it is already ranked. Otherwise, it can only
+  // displace the last (least used or empty) entry
+  std::size_t slot = ranking.size() - 1;
+  bool ranked = false;
+  for (std::size_t i = 0; i < ranking.size() && !ranked; i++) {
+    if (ranking[i].count != 0 && ranking[i].offset == entry.offset) {
+      slot = i;
+      ranked = true;
     }
+  }
+  if (!ranked && entry.count <= ranking[slot].count) return;
+  ranking[slot] = entry;
+
+  // Restore the order by moving the entry up (or, if its count decreased,
+  // down) past its neighbours
+  while (slot > 0 && ranking[slot - 1].count < ranking[slot].count) {
+    std::swap(ranking[slot - 1], ranking[slot]);
+    slot--;
+  }
+  while (slot + 1 < ranking.size() &&
+      ranking[slot + 1].count > ranking[slot].count) {
+    std::swap(ranking[slot + 1], ranking[slot]);
+    slot++;
+  }
+}
 
-    if (next != nullptr) {
-      charactersFound += next->value.size();
-    } else { // No further matches for the remaining unfound characters
-      break; // Ensures we don't assign currentNode to next and return a nullptr
+void Autocomplete::rerank(std::uint32_t node, std::string_view prefix) {
+  // The accounts beneath the node are those beginning with the prefix, which
+  // are adjacent in the sorted account array
+  rankings[node] = {};
+  for (auto account = find(prefix); account != accounts.end(); account++) {
+    std::string_view name = text.substr(account->offset, account->length);
+    if (!name.starts_with(prefix)) break;
+    auto used = usage.find(account->offset);
+    if (used == usage.end() || used->second == 0) continue;
+    rank(node, {account->offset, account->length, used->second});
+  }
+}
+
+void Autocomplete::build(std::vector<std::string> const& accounts) {
+  // Copy the account names into the text arena, recording where each begins
+  std::vector<std::uint32_t> offsets;
+  offsets.reserve(accounts.size());
+  for (auto const& account : accounts) {
+    offsets.push_back(textStorage.size());
+    accountStorage.push_back({offsets.back(),
+	static_cast<std::uint32_t>(account.size())});
+    textStorage.insert(textStorage.end(), account.begin(), account.end());
+  }
+
+  // Fuzzy matching is case-insensitive, so prepare a folded copy of the names
+  // along with the bitset of the characters in each
+  foldedStorage = textStorage;
+  for (char& c : foldedStorage) c = fold(c);
+  for (Account const& account : accountStorage) {
+    maskStorage.push_back(mask({foldedStorage.data() + account.offset,
+	account.length}));
+  }
+
+  // A range of sorted accounts sharing their first depth characters (the path
+  // from the root to node)
+  struct Range {
+    std::uint32_t node;
+    int first;
+    int last;
+    int depth;
+  };
+
+  nodeStorage.push_back(Node{});
+  keyStorage.push_back('\0');
+
+  // Build the trie breadth-first so that all of a node's children can be
+  // appended to the node array together (and are therefore contiguous). Since
+  // the accounts are sorted, the accounts under each child of a node form a
+  // contiguous sub-range of that node's range, and the children are created in
+  // sorted order
+  std::vector<Range> queue{{0, 0, static_cast<int>(accounts.size()), 0}};
+  for (std::size_t q = 0; q < queue.size(); q++) {
+    Range range = queue[q];
+    nodeStorage[range.node].firstChild = nodeStorage.size();
+
+    int i = range.first;
+    while (i < range.last) {
+      // Since duplicates have been removed, at most one account (the first in
+      // sorted order) can end at this node
+      if (accounts[i].size() == range.depth) {
+	nodeStorage[range.node].terminal = true;
+	i++;
+	continue;
+      }
+
+      // Find the range of accounts sharing the next character, i.e., the
+      // accounts under the same child
+      char key = accounts[i][range.depth];
+      int j = i + 1;
+      while (j < range.last && accounts[j][range.depth] == key) j++;
+
+      // The longest common prefix of a sorted range is that of its first and
+      // last elements
+      std::string const& front = accounts[i];
+      std::string const& back = accounts[j - 1];
+      int common = range.depth + 1;
+      while (common < front.size() && common < back.size() &&
+	  front[common] == back[common]) {
+	common++;
+      }
+
+      nodeStorage.push_back(Node{
+	.label = offsets[i] + range.depth,
+	.labelLength = static_cast<std::uint16_t>(common - range.depth)
+      });
+      keyStorage.push_back(key);
+      nodeStorage[range.node].childCount++;
+      queue.push_back({static_cast<std::uint32_t>(nodeStorage.size() - 1), i,
+	  j, common});
+      i = j;
     }
-    currentNode = next;
   }
 
-  bool completeMatch = charactersFound == value.size();
-  value = value.substr(charactersFound);
-  result = currentNode;
-  return completeMatch;
+  viewStorage();
+}
+
+void Autocomplete::own() {
+  if (snapshot) {
+    nodeStorage.assign(nodes.begin(), nodes.end());
+    keyStorage.assign(keys.begin(), keys.end());
+    textStorage.assign(text.begin(), text.end());
+    foldedStorage.assign(folded.begin(), folded.end());
+    accountStorage.assign(accounts.begin(), accounts.end());
+    maskStorage.assign(masks.begin(), masks.end());
+    snapshot.reset();
+  }
+  // A default-constructed trie has no root
+  if (nodeStorage.empty()) {
+    nodeStorage.push_back(Node{});
+    keyStorage.push_back('\0');
+  }
+  viewStorage();
+}
+
+void Autocomplete::viewStorage() {
+  // Re-point the views after any change to the storage, which may have
+  // reallocated
+  nodes = nodeStorage;
+  keys = keyStorage;
+  text = {textStorage.data(), textStorage.size()};
+  folded = {foldedStorage.data(), foldedStorage.size()};
+  accounts = accountStorage;
+  masks = maskStorage;
 }
 
-void Autocomplete::insert(std::string value) {
-  int charactersFound;
-  Node* insertUnder = nullptr;
-  search(value, insertUnder, charactersFound);
-  std::string remaining = value.substr(charactersFound);
-  int overlap = 0;
+void Autocomplete::appendChildren(std::uint32_t parent,
+    std::vector<Child> children) {
+  // A node's children must be contiguous, so rather than shifting the rest of
+  // the node array to make room, the node's (new) set of children is appended
+  // to the end of it. The node's previous children are left unreferenced;
+  // their own children are shared with the appended copies
+  std::sort(children.begin(), children.end(), [](auto const& a, auto const& b) {
+    return static_cast<unsigned char>(a.key) <
+	static_cast<unsigned char>(b.key);
+  });
+  nodeStorage[parent].firstChild = nodeStorage.size();
+  nodeStorage[parent].childCount = children.size();
+  rankings.resize(nodeStorage.size());
+  for (Child const& child : children) {
+    nodeStorage.push_back(child.node);
+    keyStorage.push_back(child.key);
+    rankings.push_back(child.ranking);
+  }
+  viewStorage();
+}
 
-  for (Node& child : insertUnder->children) {
-    if (remaining[0] != child.value[0]) continue;
-    insertUnder = &child;
-    overlap++;
+bool Autocomplete::load(std::string const& accounts) {
+  int descriptor = open(snapshotFile.c_str(), O_RDONLY);
+  if (descriptor < 0) return false;
+  struct stat status;
+  if (fstat(descriptor, &status) < 0 ||
+      status.st_size < static_cast<off_t>(sizeof(Header))) {
+    close(descriptor);
+    return false;
+  }
+  std::size_t size = status.st_size;
+  void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+  close(descriptor); // The mapping remains valid after closing
+  if (data == MAP_FAILED) return false;
+  std::shared_ptr<void const> mapping{data, [size](void const* data) {
+    munmap(const_cast<void*>(data), size);
+  }};
 
-    // Use the minimum between the remaining string size and the child node's
-    // string size as the range of the for loop
-    int remainingSize = remaining.size();
-    int childSize = child.value.size();
-    int range = remainingSize < childSize ? remainingSize : childSize;
+  // Reject snapshots written by a different version of the program, or that
+  // have been truncated
+  char const* bytes = static_cast<char const*>(data);
+  Header const& header = *reinterpret_cast<Header const*>(bytes);
+  if (std::memcmp(header.magic, magic, sizeof(magic)) != 0 ||
+      header.version != version || header.nodeSize != sizeof(Node)) {
+    return false;
+  }
+  for (Section const& section : header.sections) {
+    if (section.offset % sectionAlignment != 0 || section.offset > size ||
+	section.size > size - section.offset) {
+      return false;
+    }
+  }
+  // Views over each section, checked to hold a whole number of elements
+  auto view = [&]<typename T>(SectionIndex index, std::span<T const>& span) {
+    Section const& section = header.sections[index];
+    if (section.size % sizeof(T) != 0) return false;
+    span = {reinterpret_cast<T const*>(bytes + section.offset),
+	section.size / sizeof(T)};
+    return true;
+  };
+  std::span<Node const> nodeView;
+  std::span<char const> keyView;
+  std::span<char const> textView;
+  std::span<char const> foldedView;
+  std::span<Account const> accountView;
+  std::span<std::uint64_t const> maskView;
+  std::span<Source const> sources;
+  std::span<char const> pathView;
+  std::span<Pattern const> patternView;
+  if (!view(NODES, nodeView) || !view(KEYS, keyView) || !view(TEXT, textView)
+      || !view(FOLDED, foldedView) || !view(ACCOUNTS, accountView) ||
+      !view(MASKS, maskView) || !view(SOURCES, sources) ||
+      !view(PATHS, pathView) || !view(PATTERNS, patternView) ||
+      nodeView.empty() || keyView.size() != nodeView.size() ||
+      foldedView.size() != textView.size() ||
+      maskView.size() != accountView.size() || sources.empty()) {
+    return false;
+  }
+  // A snapshot damaged after it was written (e.g., by a partial copy) may
+  // still have a sound header, so the indices within its sections are checked
+  // too rather than trusted
+  if (!valid(nodeView, accountView, textView.size())) return false;
 
-    // Count the number of consecutive characters that are common between the
-    // two strings, starting at the front
-    for (int i = overlap; i < range; i++) {
-      if (remaining[i] == child.value[i]) {
-	overlap++;
-      } else {
-	break;
+  // Reject snapshots built from a different journal, or from journal files
+  // that have since changed. Files whose size and modification time both match
+  // are assumed to be unchanged; a differing modification time alone (e.g.,
+  // after the file was copied or touched) is settled by comparing hashes
+  std::string_view paths{pathView.data(), pathView.size()};
+  std::vector<std::string> files;
+  for (std::size_t i = 0; i < sources.size(); i++) {
+    Source const& expected = sources[i];
+    if (expected.pathOffset > paths.size() ||
+	expected.pathLength > paths.size() - expected.pathOffset) {
+      return false;
+    }
+    std::string path{paths.substr(expected.pathOffset, expected.pathLength)};
+    if (i == 0 && path != accounts) return false;
+    files.push_back(path);
+
+    struct stat current;
+    if (stat(path.c_str(), &current) < 0) return false;
+    if (static_cast<std::uint64_t>(current.st_size) != expected.size) {
+      return false;
+    }
+    if (current.st_mtim.tv_sec != expected.seconds ||
+	current.st_mtim.tv_nsec != expected.nanoseconds) {
+      Source actual;
+      if (!fingerprint(path, actual) || actual.hash != expected.hash) {
+	return false;
       }
     }
+  }
 
-    // The first character of each child node's string is guaranteed to be
-    // unique from all other child nodes (this first character is the radix of
-    // the trie). If we have made it this far in the loop (i.e., we have matched
-    // the first character of this particular node's string with that of the
-    // remaining insertion string), then we can safely disregard all other child
-    // nodes and break out of the loop
-    break;
+  // Files that begin (or cease) to match an include since the snapshot was
+  // saved aren't among its sources, so each include is expanded again
+  std::vector<std::string> patterns;
+  for (Pattern const& expected : patternView) {
+    if (expected.pathOffset > paths.size() ||
+	expected.pathLength > paths.size() - expected.pathOffset) {
+      return false;
+    }
+    std::string pattern{paths.substr(expected.pathOffset,
+	expected.pathLength)};
+    if (matches(pattern) != expected.hash) return false;
+    patterns.push_back(pattern);
   }
 
-  if (overlap > 0) {
-    // Split the node we're inserting under
-    std::string originalValue = insertUnder->value;
-    insertUnder->value = originalValue.substr(0, overlap);
+  nodes = nodeView;
+  keys = keyView;
+  text = {textView.data(), textView.size()};
+  folded = {foldedView.data(), foldedView.size()};
+  this->accounts = accountView;
+  masks = maskView;
+  snapshot = std::move(mapping);
+  sourceFiles = std::move(files);
+  sourcePatterns = std::move(patterns);
+  return true;
+}
 
-    Node suffixNode = {
-      .value = originalValue.substr(overlap),
-      .children = std::move(insertUnder->children),
-      .numberOfChildren = insertUnder->numberOfChildren
-    };
+void Autocomplete::save() const {
+  std::vector<Source> sources;
+  std::string paths;
+  for (auto const& file : sourceFiles) {
+    Source source;
+    // A snapshot that can't be validated would never be used
+    if (!fingerprint(file, source)) return;
+    source.pathOffset = paths.size();
+    source.pathLength = file.size();
+    paths.append(file);
+    sources.push_back(source);
+  }
+  std::vector<Pattern> patterns;
+  for (auto const& pattern : sourcePatterns) {
+    patterns.push_back({
+      .hash = matches(pattern),
+      .pathOffset = paths.size(),
+      .pathLength = pattern.size()
+    });
+    paths.append(pattern);
+  }
 
-    insertUnder->children.push_front(std::move(suffixNode));
-    insertUnder->numberOfChildren = 1;
+  // The contents of each section, in the order of SectionIndex
+  std::span<char const> contents[SECTION_COUNT] = {
+    {reinterpret_cast<char const*>(nodes.data()), nodes.size_bytes()},
+    keys,
+    {text.data(), text.size()},
+    {folded.data(), folded.size()},
+    {reinterpret_cast<char const*>(accounts.data()), accounts.size_bytes()},
+    {reinterpret_cast<char const*>(masks.data()), masks.size_bytes()},
+    {reinterpret_cast<char const*>(sources.data()), sources.size() *
+	sizeof(Source)},
+    {paths.data(), paths.size()},
+    {reinterpret_cast<char const*>(patterns.data()), patterns.size() *
+	sizeof(Pattern)}
+  };
+
+  Header header = {};
+  std::memcpy(header.magic, magic, sizeof(magic));
+  header.version = version;
+  header.nodeSize = sizeof(Node);
+  std::uint64_t offset = sizeof(Header);
+  for (int i = 0; i < SECTION_COUNT; i++) {
+    offset = align(offset, sectionAlignment);
+    header.sections[i] = {offset, contents[i].size()};
+    offset += contents[i].size();
   }
 
-  // Insert the remaining string, less any overlap, under the node to be
-  // inserted under. In the event where the node we're inserting under has been
-  // split, make sure we only insert a new node if the remaining string to be
-  // inserted is not equal to the newly-split prefix node's string; otherwise,
-  // the remaining string is already "present" in the trie (this would occur
-  // when inserting e.g., "tea" after "team")
-  if (overlap < remaining.size()) {
-    Node newNode = {
-      .value = remaining.substr(overlap)
-    };
+  // Write to a temporary file and rename it over the snapshot so that other
+  // processes never map a partially written snapshot. Failing to save is not an
+  // error; the trie will simply be rebuilt next time
+  std::string temporaryFile = snapshotFile + temporarySuffix;
+  std::ofstream out{temporaryFile, std::ios_base::binary};
+  out.write(reinterpret_cast<char const*>(&header), sizeof(header));
+  for (int i = 0; i < SECTION_COUNT; i++) {
+    // Pad up to the start of the section
+    while (out && out.tellp() < static_cast<std::streamoff>(
+	  header.sections[i].offset)) {
+      out.put('\0');
+    }
+    out.write(contents[i].data(), contents[i].size());
+  }
+  out.close();
+
+  std::error_code error;
+  if (out.fail()) {
+    std::filesystem::remove(temporaryFile, error);
+  } else {
+    std::filesystem::rename(temporaryFile, snapshotFile, error);
+  }
+}
+
+bool Autocomplete::fingerprint(std::string const& file, Source& source) {
+  int descriptor = open(file.c_str(), O_RDONLY);
+  if (descriptor < 0) return false;
+  struct stat status;
+  if (fstat(descriptor, &status) < 0) {
+    close(descriptor);
+    return false;
+  }
+  source = {
+    .size = static_cast<std::uint64_t>(status.st_size),
+    .seconds = status.st_mtim.tv_sec,
+    .nanoseconds = status.st_mtim.tv_nsec
+  };
 
-    insertUnder->children.push_front(std::move(newNode));
-    insertUnder->numberOfChildren++;
+  // 64-bit FNV-1a over the file's contents
+  std::uint64_t hash = 0xcbf29ce484222325;
+  if (source.size > 0) {
+    void* data = mmap(nullptr, source.size, PROT_READ, MAP_PRIVATE, descriptor,
+	0);
+    if (data == MAP_FAILED) {
+      close(descriptor);
+      return false;
+    }
+    auto const* bytes = static_cast<unsigned char const*>(data);
+    for (std::uint64_t i = 0; i < source.size; i++) {
+      hash = (hash ^ bytes[i]) * 0x100000001b3;
+    }
+    munmap(data, source.size);
+  }
+  close(descriptor);
+  source.hash = hash;
+  return true;
+}
+
+bool Autocomplete::valid(std::span<Node const> nodes, std::span<Account const>
+    accounts, std::size_t textSize) {
+  for (Account const& account : accounts) {
+    if (account.offset > textSize || account.length > textSize -
+	account.offset) {
+      return false;
+    }
+  }
+
+  // Walk the nodes reachable from the root. Nodes left unreferenced by
+  // appendChildren share their children with their copies, so they are
+  // skipped rather than checked for being reached twice
+  std::vector<bool> reached(nodes.size());
+  std::vector<std::uint32_t> pending{0};
+  reached[0] = true;
+  while (!pending.empty()) {
+    Node const& node = nodes[pending.back()];
+    pending.pop_back();
+    if (node.label > textSize || node.labelLength > textSize - node.label ||
+	node.firstChild > nodes.size() ||
+	node.childCount > nodes.size() - node.firstChild) {
+      return false;
+    }
+    for (std::uint32_t child = node.firstChild;
+	child < node.firstChild + node.childCount; child++) {
+      // Lookups descend a label at a time, so a node reached twice (or an
+      // empty label) could send them round in circles
+      if (reached[child] || nodes[child].labelLength == 0) return false;
+      reached[child] = true;
+      pending.push_back(child);
+    }
+  }
+  return true;
+}
+
+std::uint64_t Autocomplete::matches(std::string const& pattern) {
+  // 64-bit FNV-1a over the matching paths, each followed by a null. Matches
+  // are sorted, so the same files always give the same hash
+  std::uint64_t hash = 0xcbf29ce484222325;
+  glob_t found;
+  if (glob(pattern.c_str(), 0, nullptr, &found) == 0) {
+    for (std::size_t i = 0; i < found.gl_pathc; i++) {
+      // Include the terminating null
+      std::string_view path{found.gl_pathv[i], std::strlen(found.gl_pathv[i])
+	+ 1};
+      for (unsigned char byte : path) hash = (hash ^ byte) * 0x100000001b3;
+    }
+  }
+  globfree(&found);
+  return hash;
+}
+
+std::uint64_t Autocomplete::mask(std::string_view folded) {
+  // Letters and digits each get their own bit. Everything else shares the
+  // remaining bits, which can only cause false positives (which the matcher
+  // then rejects), never false negatives
+  std::uint64_t result = 0;
+  for (char c : folded) {
+    int bit;
+    if ('a' <= c && c <= 'z') {
+      bit = c - 'a';
+    } else if ('0' <= c && c <= '9') {
+      bit = 26 + c - '0';
+    } else {
+      bit = 36 + static_cast<unsigned char>(c) % 28;
+    }
+    result |= std::uint64_t{1} << bit;
   }
+  return result;
 }
@@ -2,25 +2,170 @@
 #define AUTOCOMPLETE_H
 
 #include <string>
-#include <fstream>
+#include <string_view>
+#include <vector>
+#include <span>
+#include <memory>
+#include <algorithm>
+#include <limits>
+#include <cstdint>
+#include <cstring>
 #include <stdexcept>
-#include <regex>
-#include <forward_list>
+#include <fstream>
+#include <filesystem>
+#include <utility>
+#include <array>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <glob.h>
 
+#include "journal_scanner.hpp"
+#include "memory_stats.hpp"
+
+// Radix trie of account names laid out in contiguous arrays. Nodes are
+// addressed by 32-bit indices and each node's children occupy a contiguous,
+// sorted run of the node array, so finding a child is a scan over a handful of
+// adjacent key bytes. Node labels aren't stored individually; each refers to a
+// substring of an account name held in a single text arena.
+//
+// Since the arrays contain no pointers, a built trie is saved as a snapshot
+// file that later runs map into memory and use as-is, provided that the
+// journal files it was built from haven't changed.
+//
+// Each node also caches the few most used accounts beneath it, so that the
+// likeliest completions of a prefix are found without walking its subtree.
+// Usage changes from session to session and so is kept in memory only
 class Autocomplete {
 public:
-  Autocomplete(std::string accounts);
+  Autocomplete(std::string accounts, std::string snapshotFile = "");
   Autocomplete() = default;
-  std::string complete(std::string partial);
+  // The arrays may be views into this object's own storage, so copying would
+  // leave the copy viewing the original's storage. Moving keeps the storage's
+  // buffers (and therefore the views) intact
+  Autocomplete(Autocomplete const&) = delete;
+  Autocomplete& operator=(Autocomplete const&) = delete;
+  Autocomplete(Autocomplete&&) = default;
+  Autocomplete& operator=(Autocomplete&&) = default;
+  // Extends partial to the longest completion shared by all accounts it is a
+  // prefix of
+  std::string complete(std::string partial) const;
+  // Accounts containing the characters of query in order (case-insensitively),
+  // best match first
+  std::vector<std::string> candidates(std::string_view query, int limit) const;
+  // The most used accounts beginning with prefix, most used first
+  std::vector<std::string> frequent(std::string_view prefix) const;
+  // Adds count to an account's usage (ignored if the account doesn't exist)
+  void use(std::string_view name, std::int64_t count = 1);
+  // Adds an account to the trie in place, returning false if it already exists
+  bool insert(std::string_view name);
+  // Appends account directives for the accounts added by insert to the
+  // journal, then updates the snapshot to match. Accounts whose every use has
+  // since been taken back (e.g., mistyped accounts that were undone) are left
+  // out
+  void writeAdded();
 private:
   struct Node {
-    std::string value;
-    std::forward_list<Node> children; // Radix is all printable ASCII characters
-    int numberOfChildren = 0;
+    std::uint32_t label = 0; // Offset of the node's label in text
+    std::uint32_t firstChild = 0; // Index of the first of the node's children
+    std::uint16_t labelLength = 0;
+    std::uint16_t childCount = 0; // Radix is all byte values
+    bool terminal = false; // True if the path to this node spells an account
+  };
+  struct Account {
+    std::uint32_t offset; // Offset of the account's name in text
+    std::uint32_t length;
+  };
+  struct Ranked {
+    std::uint32_t offset = 0; // Identifies the account by its name's offset
+    std::uint32_t length = 0;
+    std::int64_t count = 0; // Zero marks an empty slot
+  };
+  // Sorted by count, descending. Four entries fill a cache line
+  typedef std::array<Ranked, 4> Ranking;
+  // A node to be appended to the node array, along with its ranking
+  struct Child {
+    char key;
+    Node node;
+    Ranking ranking = {};
+  };
+  // Identifies the exact contents of a journal file the trie was built from
+  struct Source {
+    std::uint64_t size;
+    std::int64_t seconds; // Modification time
+    std::int64_t nanoseconds;
+    std::uint64_t hash;
+    std::uint64_t pathOffset; // Offset of the file's path in the path blob
+    std::uint64_t pathLength;
+  };
+  // Identifies the files matching an include directive's pattern
+  struct Pattern {
+    std::uint64_t hash; // Of the matching paths
+    std::uint64_t pathOffset; // Offset of the pattern in the path blob
+    std::uint64_t pathLength;
+  };
+  struct Section {
+    std::uint64_t offset;
+    std::uint64_t size; // In bytes
+  };
+  enum SectionIndex {NODES, KEYS, TEXT, FOLDED, ACCOUNTS, MASKS, SOURCES, PATHS,
+    PATTERNS, SECTION_COUNT};
+  struct Header {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t nodeSize; // Guards against layout changes between builds
+    Section sections[SECTION_COUNT];
+  };
+  std::vector<Node> nodeStorage;
+  std::vector<char> keyStorage;
+  std::vector<char> textStorage;
+  std::vector<char> foldedStorage;
+  std::vector<Account> accountStorage;
+  std::vector<std::uint64_t> maskStorage;
+  std::shared_ptr<void const> snapshot; // Keeps a mapped snapshot alive
+  std::string snapshotFile;
+  std::vector<std::string> sourceFiles; // The journal is the first file
+  std::vector<std::string> sourcePatterns; // Of the journal's includes
+  struct Added {
+    std::string name;
+    std::int64_t uses = 0; // This session's uses, less those taken back
   };
-  struct Node root;
-  bool search(std::string value, Node*& result, int& charactersFound);
-  void insert(std::string value);
+  std::vector<Added> added;
+  // Indexed by node. May be shorter than the node array, in which case the
+  // remaining nodes have empty rankings
+  std::vector<Ranking> rankings;
+  std::unordered_map<std::uint32_t, std::int64_t> usage; // Keyed by offset
+  std::span<Node const> nodes; // The root is always the first node
+  std::span<char const> keys; // The first character of each node's label
+  std::string_view text; // Arena of the account names, one after another
+  std::string_view folded; // Lowercase copy of text
+  std::span<Account const> accounts; // In sorted order
+  // Bitset of the (case-folded) characters present in each account's name
+  std::span<std::uint64_t const> masks;
+  std::uint32_t child(std::uint32_t node, char key) const;
+  std::string_view label(std::uint32_t node) const;
+  bool locate(std::string_view prefix, std::uint32_t& node, std::string_view&
+      rest) const;
+  std::span<Account const>::iterator find(std::string_view name) const;
+  Ranking ranking(std::uint32_t node) const;
+  void rank(std::uint32_t node, Ranked entry);
+  // Ranks the accounts beneath a node afresh from their usage
+  void rerank(std::uint32_t node, std::string_view prefix);
+  void build(std::vector<std::string> const& accounts);
+  void own();
+  void viewStorage();
+  void appendChildren(std::uint32_t parent, std::vector<Child> children);
+  int score(std::string_view query, std::string_view name) const;
+  bool load(std::string const& accounts);
+  void save() const;
+  static bool valid(std::span<Node const> nodes, std::span<Account const>
+      accounts, std::size_t textSize);
+  static bool fingerprint(std::string const& file, Source& source);
+  static std::uint64_t matches(std::string const& pattern);
+  static std::uint64_t mask(std::string_view folded);
 };
 
 #endif
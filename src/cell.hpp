@@ -8,6 +8,7 @@
 #include <format>
 
 #include "date.h"
+#include "symbol.hpp"
 
 template<typename T, typename... Ts>
 struct contains_type : std::false_type {};
@@ -179,7 +180,10 @@ private:
 
 using Amount = int64_t;
 
-class Cell : GenericCell<std::string, Amount, std::chrono::year_month_day> {
+// Free-form text such as payees and account names is stored as an interned
+// Symbol rather than a std::string once a table has been loaded
+class Cell : GenericCell<std::string, Amount, std::chrono::year_month_day,
+    Symbol> {
 public:
   using GenericCell::GenericCell;
   using GenericCell::as;
@@ -248,6 +252,8 @@ template<>
 inline std::string Cell::as<std::string>(std::string format) const {
   if (typeID == typeid(std::string).hash_code()) {
     return *reinterpret_cast<std::string const*>(buffer);
+  } else if (typeID == typeid(Symbol).hash_code()) {
+    return std::string{reinterpret_cast<Symbol const*>(buffer)->str()};
   } else if (typeID == typeid(Amount).hash_code()) {
     // Format amount
     auto contents = *reinterpret_cast<Amount const*>(buffer);
@@ -0,0 +1,26 @@
+#include "fenwick_tree.hpp"
+
+FenwickTree::FenwickTree(std::vector<std::int64_t> const& values) :
+    sums(values.size() + 1) {
+  // Each entry passes its completed sum on to the entry whose run contains its
+  // own, rather than every value being added along its path separately
+  for (int index = 1; index < sums.size(); index++) {
+    sums[index] += values[index - 1];
+    int parent = index + (index & -index);
+    if (parent < sums.size()) sums[parent] += sums[index];
+  }
+}
+
+int FenwickTree::size() const { return sums.size() - 1; }
+
+void FenwickTree::add(int index, std::int64_t delta) {
+  for (index++; index < sums.size(); index += index & -index) {
+    sums[index] += delta;
+  }
+}
+
+std::int64_t FenwickTree::prefix(int end) const {
+  std::int64_t sum = 0;
+  for (; end > 0; end -= end & -end) sum += sums[end];
+  return sum;
+}
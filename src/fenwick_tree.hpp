@@ -0,0 +1,24 @@
+#ifndef FENWICK_TREE_H
+#define FENWICK_TREE_H
+
+#include <vector>
+#include <cstdint>
+
+// Sums of a fixed number of values, of which any prefix can be summed and any
+// one value changed in O(log n). Each entry of the tree holds the sum of the
+// run of values ending at it whose length is the lowest set bit of its
+// (one-based) index, so both operations visit one entry per bit of the index
+class FenwickTree {
+public:
+  // Builds the tree over the values in O(n)
+  FenwickTree(std::vector<std::int64_t> const& values = {});
+  int size() const;
+  // Adds delta to the value at index
+  void add(int index, std::int64_t delta);
+  // The sum of the values before end
+  std::int64_t prefix(int end) const;
+private:
+  std::vector<std::int64_t> sums; // One-based, so the first entry is unused
+};
+
+#endif
@@ -3,20 +3,11 @@
 // Pass tables by value to isolate amountAlignment calculation from changes that
 // may be made to tables outside of this class
 Formatter::Formatter(TableArray tables, toml::table const& format) :
-    tables{tables} {
-  locale = format["locale"].value_or("");
-  // In this case we use direct-initialization (i.e., ()) instead of
-  // list-initialization (i.e., {}) to avoid calling std::basic_string's
-  // std::initializer_list constructor, which would treat both arguments as
-  // characters to construct the string with. This is not the constructor we
-  // want to use, and has the added downside of creating a string with (likely)
-  // a non-printable ASCII character due to the first argument being an integer
-  indentation = std::string(format["indentation"].value_or(4), ' ');
-  margin = std::string(format["margin "].value_or(8), ' ');
+    Formatter{format, 0} {
+  this->tables = tables;
 
   // Determine the column against which amounts should be aligned in the ledger
   // output based off of the widest source/destination string across all tables
-  amountAlignment = 0;
   for (auto& table : tables) {
     int sourceWidth = table.getAccount().size();
     int destinationWidth = table.columnWidth(table.width() - 1);
@@ -25,6 +16,19 @@ Formatter::Formatter(TableArray tables, toml::table const& format) :
   }
 }
 
+Formatter::Formatter(toml::table const& format, int amountAlignment) :
+    amountAlignment{amountAlignment} {
+  locale = format["locale"].value_or("");
+  // In this case we use direct-initialization (i.e., ()) instead of
+  // list-initialization (i.e., {}) to avoid calling std::basic_string's
+  // std::initializer_list constructor, which would treat both arguments as
+  // characters to construct the string with. This is not the constructor we
+  // want to use, and has the added downside of creating a string with (likely)
+  // a non-printable ASCII character due to the first argument being an integer
+  indentation = std::string(format["indentation"].value_or(4), ' ');
+  margin = std::string(format["margin "].value_or(8), ' ');
+}
+
 std::ostream& operator<<(std::ostream& out, Formatter const& formatter) {
   TableArray const& tables = formatter.tables;
 
@@ -39,6 +43,7 @@ std::ostream& operator<<(std::ostream& out, Formatter const& formatter) {
   // Start tracking the number of tables whose cursors have not reached their
   // end
   int remaining = tables.size();
+  formatter.prepare(out);
 
   auto compare = [&](int a, int b) {
     Table const& tableA = tables[a];
@@ -77,59 +82,74 @@ std::ostream& operator<<(std::ostream& out, Formatter const& formatter) {
   return out;
 }
 
-// TODO: Change name to formatTransaction(?) Add formatPosting function to
-// format a row that's been split as a compository posting in a single
-// transaction (will require tracking which rows in a table have been split)
+void Formatter::prepare(std::ostream& out) const {
+  // Constructing a named locale is slow enough to matter when done per row
+  out.imbue(std::locale(locale));
+  out << std::showbase; // Show dollar sign when reporting amount
+}
+
+// TODO: Add formatPosting function to format a row that's been split as a
+// compository posting in a single transaction (will require tracking which
+// rows in a table have been split)
 void Formatter::formatRow(std::ostream& out, Table const& table, int index)
     const {
   Table::ConstIterator iterator = table.cbegin() + index;
+  formatTransaction(out, {
+    .date = table.getDate(iterator),
+    .payee = table.getPayee(iterator).str(),
+    .account = table.getAccount().str(),
+    .counterparty = table.getCounterparty(iterator).str(),
+    .amount = table.amount(iterator),
+    .normalBalance = table.normalBalance()
+  });
+}
 
-  out.imbue(std::locale(locale));
-  out << std::showbase; // Show dollar sign when reporting amount
-  out << table.getDate(iterator) << ' ';
+void Formatter::formatTransaction(std::ostream& out, Transaction const&
+    transaction) const {
+  out << transaction.date << ' ';
 
   std::string padding;
-  Amount amount = table.amount(iterator);
+  Amount amount = transaction.amount;
 
   // Format either a complete transaction (two postings) or an incomplete
   // transaction (one posting)
-  if (!table.getCounterparty(iterator).empty()) {
+  if (!transaction.counterparty.empty()) {
     // Select the correct accounts to use for the positive-valued posting and
     // the elided posting that constitute the Ledger transaction. See section
     // 5.2 of Ledger manual for meaning of elision in a formatting context
-    std::string positiveAccount; // The debtor in the transaction
-    std::string elidedAccount; // The creditor in the transaction
-    if (table.normalBalance() == Descriptor::DEBIT) {
+    std::string_view positiveAccount; // The debtor in the transaction
+    std::string_view elidedAccount; // The creditor in the transaction
+    if (transaction.normalBalance == Descriptor::DEBIT) {
       if (amount >= 0) { // DEBIT
-	positiveAccount = table.getAccount();
-	elidedAccount = table.getCounterparty(iterator);
+	positiveAccount = transaction.account;
+	elidedAccount = transaction.counterparty;
       } else { // CREDIT
 	amount = -amount;
-	positiveAccount = table.getCounterparty(iterator);
-	elidedAccount = table.getAccount();
+	positiveAccount = transaction.counterparty;
+	elidedAccount = transaction.account;
       }
-    } else { // table.normalBalance() == Descriptor::CREDIT
+    } else { // transaction.normalBalance == Descriptor::CREDIT
       if (amount >= 0) { // CREDIT
-	positiveAccount = table.getCounterparty(iterator);
-	elidedAccount = table.getAccount();
+	positiveAccount = transaction.counterparty;
+	elidedAccount = transaction.account;
       } else { // DEBIT
 	amount = -amount;
-	positiveAccount = table.getAccount();
-	elidedAccount = table.getCounterparty(iterator);
+	positiveAccount = transaction.account;
+	elidedAccount = transaction.counterparty;
       }
     }
 
     padding.append(amountAlignment - positiveAccount.size(), ' ');
     out << "* ";
-    out << table.getPayee(iterator) << '\n';
+    out << transaction.payee << '\n';
     out << indentation << positiveAccount << padding;
     out << margin << std::put_money(amount) << '\n';
     out << indentation << elidedAccount;
   } else {
-    padding.append(amountAlignment - table.getAccount().size(), ' ');
+    padding.append(amountAlignment - transaction.account.size(), ' ');
     out << "! ";
-    out << table.getPayee(iterator) << '\n';
-    out << indentation << table.getAccount() << padding;
+    out << transaction.payee << '\n';
+    out << indentation << transaction.account << padding;
     out << margin  << std::put_money(amount);
   }
   out << '\n';
@@ -16,9 +16,26 @@
 
 class Formatter {
 public:
+  // A row as a Ledger transaction. The counterparty is empty if the row hasn't
+  // been categorized
+  struct Transaction {
+    std::chrono::year_month_day date;
+    std::string_view payee;
+    std::string_view account;
+    std::string_view counterparty;
+    Amount amount;
+    Descriptor::AccountKind normalBalance;
+  };
   Formatter(TableArray tables, toml::table const& format);
+  // For formatting transactions one at a time, rather than from tables.
+  // Amounts are aligned as though the widest account were of the given width
+  Formatter(toml::table const& format, int amountAlignment);
   friend std::ostream& operator<<(std::ostream& out, Formatter const&
       formatter);
+  // Readies a stream for formatTransaction
+  void prepare(std::ostream& out) const;
+  void formatTransaction(std::ostream& out, Transaction const& transaction)
+      const;
 private:
   TableArray tables;
   std::string locale;
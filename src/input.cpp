@@ -1,26 +1,34 @@
 #include "input.hpp"
 
-Input::Input(TableViewArray& tableViewArray, Prompt& prompt, std::string
-    accountsFile) : tableViewArray{tableViewArray}, prompt{prompt} {
-  try {
-    autocomplete = {accountsFile};
-  } catch (std::runtime_error const& e) {
-    // TODO: log warning properly
-    std::cerr << e.what() << '\n';
+namespace {
+  constexpr int candidateLimit = 8; // Number of fuzzy matches offered
+
+  std::string dollars(Amount amount) {
+    return std::format("{:.2f}", amount / 100.0);
   }
+}
 
+Input::Input(TableViewArray& tableViewArray, Prompt& prompt,
+    std::vector<std::string> const& statements, std::string accountsFile,
+    bool appendAccounts) : tableViewArray{tableViewArray},
+    prompt{prompt}, appendAccounts{appendAccounts},
+    search{tableViewArray.tableArray()} {
 #ifdef DEBUG
   std::filesystem::path transactionMapFile;
   transactionMapFile = std::filesystem::current_path() / MAP;
-  // std::filesystem::path is implicitly convertible to a string in this case
-  // (since std::string is explicitly defined as the constructor argument's
-  // type)
-  transactionMap = {transactionMapFile};
+  std::filesystem::path snapshotFile;
+  snapshotFile = std::filesystem::current_path() / TRIE;
+  std::filesystem::path sessionFile;
+  sessionFile = std::filesystem::current_path() / SESSION;
 #else
-  // Define transaction map file path
+  // Define transaction map and autocomplete snapshot file paths
   std::filesystem::path transactionMapFile;
+  std::filesystem::path snapshotFile;
+  std::filesystem::path sessionFile;
   if (char const* home = std::getenv("HOME")) {
     transactionMapFile = std::filesystem::path{home} / MAP;
+    snapshotFile = std::filesystem::path{home} / TRIE;
+    sessionFile = std::filesystem::path{home} / SESSION;
   } else {
     // TODO: log warning properly
     std::cerr << "Warning: User's $HOME environment variable is not set, ";
@@ -37,16 +45,68 @@ Input::Input(TableViewArray& tableViewArray, Prompt& prompt, std::string
       std::cerr << "directory - " << e.what() << '\n';
     }
   }
-  transactionMap = {transactionMapFile};
 #endif
+  {
+    // std::filesystem::path is implicitly convertible to a string in this
+    // case (since std::string is explicitly defined as the constructor
+    // argument's type)
+    Profile::Scope scope{"load transaction map", transactionMapFile};
+    transactionMap = {transactionMapFile};
+  }
+
+  {
+    Profile::Scope scope{"load autocomplete", accountsFile};
+    try {
+      autocomplete = {accountsFile, snapshotFile};
+    } catch (std::runtime_error const& e) {
+      // TODO: log warning properly
+      std::cerr << e.what() << '\n';
+    }
+    // Rank completions by how often each account has been recorded before
+    for (auto const& [account, count] : transactionMap.usage()) {
+      autocomplete.use(account.str(), count);
+    }
+  }
+
+  if (!sessionFile.empty()) {
+    try {
+      journal = {sessionFile, statements};
+    } catch (std::runtime_error const& e) {
+      // TODO: log warning properly
+      std::cerr << e.what() << '\n';
+    }
+  }
+  {
+    Profile::Scope scope{"resume session"};
+    resume();
+  }
 
   // Set up initial prompt
   promptAfterScroll();
 }
 
-// TODO: dynamically update autocomplete radix tree with new account names
+Input::~Input() {
+  // New accounts are collected over the session and written in one batch
+  if (appendAccounts) autocomplete.writeAdded();
+  // Write the map here rather than leave it to the map's destructor, so that
+  // the journal can note that this session's tallies are written. A session
+  // resumed from the journal would otherwise tally them again
+  try {
+    transactionMap.write();
+    journal.append({.type = SessionJournal::Entry::MAPPED});
+  } catch (std::exception const& e) {
+    // The map tries again (and reports the error) on its destruction
+  }
+}
+
 void Input::evaluate() {
   while (state != QUIT) {
+    // Flushing the changes made in response to the last keystroke is the last
+    // of its phases
+    prompt.flush();
+    trace.mark(LatencyTrace::FLUSH);
+    trace.finish();
+
     // Get input
     Prompt::Type responseType;
     std::string input;
@@ -55,6 +115,14 @@ void Input::evaluate() {
     } catch (const std::runtime_error& e) {
       continue; // Let the user re-attempt to enter valid input
     }
+    if (responseType == Prompt::END) break;
+    trace.start();
+    // A resize leaves the state (and the prompt's input) as it was
+    if (responseType == Prompt::RESIZE) {
+      resize();
+      trace.mark(LatencyTrace::RENDER);
+      continue;
+    }
 
     // Can't declare variables inside switch statement. Pointers so that they
     // can be reassigned after resizing operations
@@ -63,22 +131,37 @@ void Input::evaluate() {
     Table::Iterator iterator = table->begin() + tableView->cursorIndex();
 
     state = nextState(responseType, input);
+    if (state != AUTOCOMPLETE) candidates.clear();
+    trace.mark(LatencyTrace::TRANSITION);
     switch (state) {
       case RECORD:
-	table->setCounterparty(iterator, input);
+	make({
+	  .type = Change::RECORD,
+	  .table = tableViewArray.focusedTableIndex(),
+	  .row = tableView->cursorIndex(),
+	  .account = Symbol{input}
+	});
+	journal.append({
+	  .type = SessionJournal::Entry::RECORD,
+	  .table = tableViewArray.focusedTableIndex(),
+	  .row = tableView->cursorIndex(),
+	  .account = input
+	});
+	trace.mark(LatencyTrace::MUTATION);
+	processed++;
 	tableViewArray.redrawFocusedView();
-	transactionMap.addRelation(table->getPayee(iterator), input);
 	try {
 	  tableViewArray.scrollDown();
 	} catch (const std::out_of_range& e) { return; }
 	promptAfterScroll();
 	break;
       case AUTOCOMPLETE:
-	prompt.writeField(autocomplete.complete(input));
+	completeField(input);
 	break;
       // TODO: give user option to select between pending and uncleared
       // transaction states
       case SKIP:
+	processed++;
 	try {
 	  tableViewArray.scrollDown();
 	} catch (const std::out_of_range& e) { return; }
@@ -96,10 +179,43 @@ void Input::evaluate() {
       case RECORD_SPLIT:
 	recordSplit(input);
 	break;
+      case UNDO:
+      case REDO: {
+	Search::Position changed;
+	bool done = state == UNDO ? undo(changed) : redo(changed);
+	if (done) {
+	  journal.append({
+	    .type = state == UNDO ? SessionJournal::Entry::UNDO :
+		SessionJournal::Entry::REDO
+	  });
+	  trace.mark(LatencyTrace::MUTATION);
+	  tableViewArray.seek(changed.table, changed.row);
+	} else {
+	  beep();
+	}
+	promptAfterScroll();
+	break;
+      }
+      case SEARCH:
+	find(input.substr(1));
+	promptAfterScroll();
+	break;
+      case FILTER:
+	filter(input.substr(1));
+	promptAfterScroll();
+	break;
     }
+    // Whatever remains is drawing the response
+    trace.mark(LatencyTrace::RENDER);
   }
 }
 
+LatencyTrace const& Input::latency() const { return trace; }
+
+int Input::rowsProcessed() const { return processed; }
+
+void Input::discardJournal() { journal.discard(); }
+
 Input::State Input::nextState(Prompt::Type responseType, std::string input) {
   State next;
 
@@ -121,6 +237,14 @@ Input::State Input::nextState(Prompt::Type responseType, std::string input) {
 	  next = BACK;
 	} else if (input == "t") {
 	  next = SPLIT;
+	} else if (input == "u") {
+	  next = UNDO;
+	} else if (input == "r") {
+	  next = REDO;
+	} else if (input.starts_with('/')) {
+	  next = SEARCH;
+	} else if (input.starts_with(':')) {
+	  next = FILTER;
 	} else {
 	  next = RECORD;
 	}
@@ -134,14 +258,34 @@ Input::State Input::nextState(Prompt::Type responseType, std::string input) {
 }
 
 void Input::promptAfterScroll() {
+  // Everything since the last mark was scrolling
+  trace.mark(LatencyTrace::RENDER);
   // Recall that a scroll action may change which table is currently focused.
   // Thus, we must re-query the TableViewArray for the currently focused table
   Table& table = tableViewArray.focusedTable();
   TableView& tableView = tableViewArray.focusedTableView();
   Table::ConstIterator iterator = table.begin() + tableView.cursorIndex();
   auto row = iterator->format(table.displayColumns());
-  auto hint = transactionMap.getCounterparty(table.getPayee(iterator));
-  prompt.amountPrompt(table.amount(iterator), row, hint);
+  Symbol hint = transactionMap.getCounterparty(table.getPayee(iterator));
+  trace.mark(LatencyTrace::HINT);
+  prompt.amountPrompt(table.amount(iterator), row, std::string{hint.str()});
+  prompt.balancePrompt(balances(tableViewArray.focusedTableIndex(),
+      tableView.cursorIndex()));
+
+  // Resuming puts the cursor back wherever it was last journaled
+  Search::Position cursor = {
+    .table = tableViewArray.focusedTableIndex(),
+    .row = tableView.cursorIndex()
+  };
+  if (cursor.table != journaledCursor.table ||
+      cursor.row != journaledCursor.row) {
+    journaledCursor = cursor;
+    journal.append({
+      .type = SessionJournal::Entry::CURSOR,
+      .table = cursor.table,
+      .row = cursor.row
+    });
+  }
 }
 
 void Input::recordSplit(std::string input) {
@@ -154,16 +298,261 @@ void Input::recordSplit(std::string input) {
     state = SPLIT; // Let the user re-attempt to enter valid input
     return;
   }
-  Table& table = tableViewArray.focusedTable();
-  TableView& tableView = tableViewArray.focusedTableView();
-  Table::Iterator iterator = table.begin() + tableView.cursorIndex();
-  Row duplicate = table[tableView.cursorIndex()];
-  table.insert(iterator, duplicate);
-  iterator = table.begin() + tableView.cursorIndex();
-  table.amount(iterator, residual);
-  iterator++;
-  table.amount(iterator, table.amount(iterator) - residual);
+  int tableIndex = tableViewArray.focusedTableIndex();
+  int cursor = tableViewArray.focusedTableView().cursorIndex();
+  make({
+    .type = Change::SPLIT,
+    .table = tableIndex,
+    .row = cursor,
+    .residual = residual
+  });
+  journal.append({
+    .type = SessionJournal::Entry::SPLIT,
+    .table = tableIndex,
+    .row = cursor,
+    .residual = residual
+  });
+  trace.mark(LatencyTrace::MUTATION);
   tableViewArray.redrawFocusedView();
+  Table& table = tableViewArray.focusedTable();
+  Table::Iterator iterator = table.begin() + cursor + 1;
   auto row = iterator->format(table.displayColumns());
   prompt.amountPrompt(table.amount(--iterator), row);
+  prompt.balancePrompt(balances(tableIndex, cursor));
+}
+
+std::string Input::balances(int table, int row) {
+  TableArray& tables = tableViewArray.tableArray();
+  std::string summary = "Balance: " + dollars(tables[table].balance(row));
+  if (tables.size() > 1) {
+    summary += "  Net: " + dollars(tables.netBalance(table, row));
+  }
+  std::optional<Amount> closing = tables[table].statedClosingBalance();
+  if (closing.has_value()) {
+    Amount difference = *closing - tables[table].balance();
+    summary += "  Closing: " + dollars(*closing);
+    if (difference == 0) {
+      summary += " (reconciled)";
+    } else {
+      summary += " (off by " + dollars(difference) + ")";
+    }
+  }
+  return summary;
+}
+
+void Input::make(Change change) {
+  apply(change);
+  history.push_back(change);
+  undone.clear(); // A new change makes the undone ones unreachable
+}
+
+void Input::apply(Change& change) {
+  Table& table = tableViewArray.tableArray()[change.table];
+  Table::Iterator iterator = table.begin() + change.row;
+  if (change.type == Change::RECORD) {
+    change.previous = table.getCounterparty(iterator);
+    table.setCounterparty(iterator, change.account);
+    if (!talliesWritten) {
+      transactionMap.addRelation(table.getPayee(iterator), change.account);
+    }
+    // Make the account available for completion for the rest of the session
+    std::string account{change.account.str()};
+    autocomplete.insert(account);
+    autocomplete.use(account);
+  } else {
+    // The row keeps the residual and its duplicate, inserted before it, takes
+    // the remainder
+    Row duplicate = table[change.row];
+    search.wait(); // The search indexes may still be reading the table
+    table.insert(iterator, duplicate);
+    iterator = table.begin() + change.row;
+    table.amount(iterator, change.residual);
+    iterator++;
+    table.amount(iterator, table.amount(iterator) - change.residual);
+  }
+}
+
+bool Input::undo(Search::Position& changed) {
+  // Each change is reverted by its inverse, which touches only the changed
+  // rows and the tallies of the recorded account
+  if (history.empty()) return false;
+  Change change = history.back();
+  history.pop_back();
+  Table& table = tableViewArray.tableArray()[change.table];
+  Table::Iterator iterator = table.begin() + change.row;
+  if (change.type == Change::RECORD) {
+    table.setCounterparty(iterator, change.previous);
+    if (!talliesWritten) {
+      transactionMap.removeRelation(table.getPayee(iterator), change.account);
+    }
+    // The account stays available for completion, only its usage is reverted
+    autocomplete.use(change.account.str(), -1);
+  } else {
+    // Fold the remainder back into the row and erase its duplicate
+    search.wait();
+    Amount total = table.amount(iterator) + table.amount(iterator + 1);
+    table.amount(iterator + 1, total);
+    table.erase(table.begin() + change.row);
+  }
+  undone.push_back(change);
+  changed = {.table = change.table, .row = change.row};
+  return true;
+}
+
+bool Input::redo(Search::Position& changed) {
+  if (undone.empty()) return false;
+  Change change = undone.back();
+  undone.pop_back();
+  apply(change);
+  history.push_back(change);
+  changed = {.table = change.table, .row = change.row};
+  return true;
+}
+
+void Input::resume() {
+  // Reapply the changes journaled by an earlier session of these statements
+  // that never finished, then return to where its cursor was left
+  auto const& entries = journal.recovered();
+  if (entries.empty()) return;
+  TableArray& tables = tableViewArray.tableArray();
+  journaledCursor = {
+    .table = tableViewArray.focusedTableIndex(),
+    .row = tableViewArray.focusedTableView().cursorIndex()
+  };
+  // The undo history is rebuilt along the way, so changes made before the
+  // interruption can still be undone
+  Search::Position changed;
+  // The tallies of the changes before the last MAPPED entry are already in
+  // the transaction map
+  int written = 0;
+  for (int i = 0; i < entries.size(); i++) {
+    if (entries[i].type == SessionJournal::Entry::MAPPED) written = i;
+  }
+  for (int i = 0; i < entries.size(); i++) {
+    auto const& entry = entries[i];
+    talliesWritten = i < written;
+    bool positioned = entry.type != SessionJournal::Entry::UNDO &&
+	entry.type != SessionJournal::Entry::REDO &&
+	entry.type != SessionJournal::Entry::MAPPED;
+    // Guards against a journal that doesn't match the tables after all
+    if (positioned && (entry.table >= tables.size() || entry.row < 1 ||
+	entry.row >= tables[entry.table].length())) {
+      break;
+    }
+    switch (entry.type) {
+      case SessionJournal::Entry::RECORD:
+	make({
+	  .type = Change::RECORD,
+	  .table = entry.table,
+	  .row = entry.row,
+	  .account = Symbol{entry.account}
+	});
+	break;
+      case SessionJournal::Entry::SPLIT:
+	make({
+	  .type = Change::SPLIT,
+	  .table = entry.table,
+	  .row = entry.row,
+	  .residual = entry.residual
+	});
+	break;
+      case SessionJournal::Entry::CURSOR:
+	journaledCursor = {.table = entry.table, .row = entry.row};
+	break;
+      case SessionJournal::Entry::UNDO:
+	undo(changed);
+	break;
+      case SessionJournal::Entry::REDO:
+	redo(changed);
+	break;
+      case SessionJournal::Entry::MAPPED:
+	break;
+    }
+  }
+  talliesWritten = false;
+  tableViewArray.seek(journaledCursor.table, journaledCursor.row);
+}
+
+void Input::completeField(std::string input) {
+  // Repeated tab presses cycle through the candidates offered by the first
+  // press, provided that the field hasn't been edited in between
+  if (!candidates.empty() && input == candidates[candidate]) {
+    candidate = (candidate + 1) % candidates.size();
+  } else {
+    // Jump straight to the most used account beginning with the input, unless
+    // the input already is the only such account
+    candidates = autocomplete.frequent(input);
+    candidate = 0;
+    if (candidates.size() == 1 && candidates.front() == input) {
+      candidates.clear();
+    }
+    // Otherwise, prefer extending the input as an exact prefix. Only once that
+    // is no longer possible (i.e., at a fork, or when no account begins with
+    // the input) fall back on ranked fuzzy matches
+    std::string completed = input;
+    if (candidates.empty()) completed = autocomplete.complete(input);
+    if (candidates.empty() && completed == input) {
+      candidates = autocomplete.candidates(input, candidateLimit);
+    }
+    trace.mark(LatencyTrace::HINT);
+    if (candidates.empty()) {
+      prompt.writeField(completed);
+      return;
+    }
+  }
+  prompt.writeField(candidates[candidate]);
+  prompt.candidatesPrompt(candidates, candidate);
+}
+
+void Input::resize() {
+  // ncurses has already updated LINES and COLS to the terminal's new size. The
+  // prompt is laid out last so that the cursor is left in its field
+  int tableHeight = LINES - prompt.height();
+  tableViewArray.resize(tableHeight, COLS);
+  prompt.resize(tableHeight, COLS);
+  // The terminal may still hold remnants of the old layout
+  clearok(curscr, TRUE);
+}
+
+void Input::find(std::string query) {
+  // An empty query repeats the last search, moving on to the next match
+  if (query.empty()) query = lastQuery;
+  lastQuery = query;
+
+  Search::Position from = {
+    .table = tableViewArray.focusedTableIndex(),
+    .row = tableViewArray.focusedTableView().cursorIndex()
+  };
+  Search::Position match;
+  bool found = search.next(query, from, match);
+  trace.mark(LatencyTrace::SEARCH);
+  if (found) {
+    tableViewArray.seek(match.table, match.row);
+  } else {
+    beep();
+  }
+}
+
+void Input::filter(std::string specifier) {
+  // :u for uncategorized rows, :d for debits, :c for credits and :>amount for
+  // rows above an amount. A bare : removes the filter
+  TableViewArray::Filter kind;
+  Amount threshold = 0;
+  bool isSigned;
+  if (specifier.empty()) {
+    kind = TableViewArray::ALL;
+  } else if (specifier == "u") {
+    kind = TableViewArray::UNCATEGORIZED;
+  } else if (specifier == "d") {
+    kind = TableViewArray::DEBITS;
+  } else if (specifier == "c") {
+    kind = TableViewArray::CREDITS;
+  } else if (specifier.starts_with('>') &&
+      Search::parseAmount(specifier.substr(1), threshold, isSigned)) {
+    kind = TableViewArray::ABOVE;
+  } else {
+    beep();
+    return;
+  }
+  if (!tableViewArray.filter(kind, threshold)) beep();
 }
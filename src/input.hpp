@@ -4,6 +4,9 @@
 #include <string>
 #include <filesystem>
 #include <iostream>
+#include <vector>
+#include <format>
+#include <optional>
 
 #include <ncurses.h>
 
@@ -11,23 +14,73 @@
 #include "prompt.hpp"
 #include "autocomplete.hpp"
 #include "transaction_map.hpp"
+#include "search.hpp"
+#include "latency_trace.hpp"
+#include "session_journal.hpp"
+#include "profile.hpp"
 
 class Input {
 public:
-  Input(TableViewArray& tableViewArray, Prompt& prompt, std::string
-      accountsFile);
+  Input(TableViewArray& tableViewArray, Prompt& prompt,
+      std::vector<std::string> const& statements, std::string accountsFile,
+      bool appendAccounts = false);
+  ~Input();
   void evaluate();
+  // Removes the session journal once the session's transactions have been
+  // written out, since there is no longer anything to resume
+  void discardJournal();
+  // The latency of each phase of handling the keystrokes evaluated so far
+  LatencyTrace const& latency() const;
+  // The number of rows recorded or skipped so far, which can fall short of
+  // the rows loaded if the session ended early
+  int rowsProcessed() const;
 private:
-  enum State {RECORD, AUTOCOMPLETE, SKIP, BACK, SPLIT, RECORD_SPLIT, QUIT};
+  enum State {RECORD, AUTOCOMPLETE, SKIP, BACK, SPLIT, RECORD_SPLIT, UNDO,
+    REDO, SEARCH, FILTER, QUIT};
+  // A change to the tables, along with what is needed to revert it
+  struct Change {
+    enum Type {RECORD, SPLIT} type;
+    int table;
+    int row;
+    Symbol account; // Of a RECORD
+    Symbol previous = {}; // The counterparty replaced by a RECORD
+    Amount residual = 0; // Of a SPLIT
+  };
   TableViewArray& tableViewArray;
   Prompt& prompt;
   Autocomplete autocomplete;
+  bool appendAccounts; // Write newly recorded accounts to the accounts file
   TransactionMap transactionMap;
+  Search search;
+  std::string lastQuery; // Repeated by an empty search
   State state = RECORD;
+  std::vector<std::string> candidates; // Offered by the last tab press
+  int candidate = 0; // Index of the candidate currently in the field
+  int processed = 0; // Rows recorded or skipped
+  LatencyTrace trace;
+  SessionJournal journal;
+  Search::Position journaledCursor = {};
+  std::vector<Change> history; // Undone from the back
+  std::vector<Change> undone; // Redone from the back
+  // Set while resuming changes whose tallies an earlier session already wrote
+  // to the transaction map, so that they aren't tallied a second time
+  bool talliesWritten = false;
   Table* focusedTable();
   State nextState(Prompt::Type responseType, std::string input);
   void promptAfterScroll();
+  // The balances at a row, along with the account's progress towards its
+  // statement's closing balance if one is known
+  std::string balances(int table, int row);
   void recordSplit(std::string input);
+  void make(Change change);
+  void apply(Change& change);
+  bool undo(Search::Position& changed);
+  bool redo(Search::Position& changed);
+  void resume();
+  void completeField(std::string input);
+  void resize();
+  void find(std::string query);
+  void filter(std::string specifier);
 };
 
 #endif
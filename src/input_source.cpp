@@ -0,0 +1,52 @@
+#include "input_source.hpp"
+
+namespace {
+  constexpr int backspace = 127;
+}
+
+bool TerminalSource::next(WINDOW* window, int& key) {
+  key = wgetch(window);
+  return true;
+}
+
+ScriptSource::ScriptSource(std::string scriptFile) {
+  std::ifstream script{scriptFile};
+  if (!script) {
+    throw std::runtime_error("Error: Could not open script " + scriptFile);
+  }
+
+  // Translate the whole script up front so that replaying it costs no more
+  // than reading keys from the terminal's input buffer
+  std::string line;
+  while (std::getline(script, line)) {
+    if (!line.empty() && line.back() == '\r') line.pop_back();
+    if (line.starts_with('#')) continue;
+    for (int i = 0; i < line.size(); i++) {
+      char c = line[i];
+      if (c == '\\' && i + 1 < line.size()) {
+	switch (line[++i]) {
+	  case 't':
+	    keys.push_back('\t');
+	    break;
+	  case 'b':
+	    keys.push_back(backspace);
+	    break;
+	  default:
+	    keys.push_back(line[i]);
+	    break;
+	}
+      } else {
+	keys.push_back(static_cast<unsigned char>(c));
+      }
+    }
+    keys.push_back('\n');
+  }
+}
+
+bool ScriptSource::next(WINDOW*, int& key) {
+  if (position == keys.size()) return false;
+  key = keys[position++];
+  return true;
+}
+
+int ScriptSource::replayed() const { return position; }
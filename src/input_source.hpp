@@ -0,0 +1,40 @@
+#ifndef INPUT_SOURCE_H
+#define INPUT_SOURCE_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <stdexcept>
+
+#include <ncurses.h>
+
+// Where the prompt reads its keys from
+class InputSource {
+public:
+  virtual ~InputSource() = default;
+  // Reads the next key into key, returning false once the source is exhausted
+  virtual bool next(WINDOW* window, int& key) = 0;
+};
+
+// Keys typed at the terminal
+class TerminalSource : public InputSource {
+public:
+  bool next(WINDOW* window, int& key) override;
+};
+
+// Keys replayed from a script, so that whole sessions can run without anyone
+// at the keyboard. Each line of the script is typed into the prompt and
+// entered. Tab characters (or \t) press tab, \b presses backspace and \\ types
+// a backslash. Lines starting with # are comments
+class ScriptSource : public InputSource {
+public:
+  ScriptSource(std::string scriptFile);
+  bool next(WINDOW* window, int& key) override;
+  // Number of keys replayed so far
+  int replayed() const;
+private:
+  std::vector<int> keys;
+  int position = 0;
+};
+
+#endif
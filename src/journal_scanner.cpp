@@ -0,0 +1,249 @@
+#include "journal_scanner.hpp"
+
+namespace {
+  bool isBlank(char c) { return c == ' ' || c == '\t'; }
+
+  std::string_view trim(std::string_view text) {
+    while (!text.empty() && isBlank(text.front())) text.remove_prefix(1);
+    while (!text.empty() && isBlank(text.back())) text.remove_suffix(1);
+    return text;
+  }
+
+  // Returns whether line begins with the given directive keyword. If so, the
+  // remainder of the line following the keyword is assigned to argument
+  bool directive(std::string_view line, std::string_view keyword,
+      std::string_view& argument) {
+    if (!line.starts_with(keyword)) return false;
+    std::string_view remainder = line.substr(keyword.size());
+    if (!remainder.empty() && !isBlank(remainder.front())) return false;
+    argument = trim(remainder);
+    return true;
+  }
+
+  // Ledger terminates an account name with either a tab or two consecutive
+  // spaces (see section 4.9 of the Ledger manual), which allows account names
+  // to contain single spaces
+  std::string_view accountName(std::string_view text) {
+    std::size_t end = 0;
+    while (end < text.size()) {
+      if (text[end] == '\t') break;
+      if (text[end] == ' ' && end + 1 < text.size() && text[end + 1] == ' ') {
+	break;
+      }
+      end++;
+    }
+    return trim(text.substr(0, end));
+  }
+
+  std::string_view postingAccount(std::string_view line) {
+    line = trim(line);
+    // Skip posting comments/metadata and any cleared/pending state marker
+    if (line.empty() || line.front() == ';') return {};
+    if (line.front() == '*' || line.front() == '!') line = trim(line.substr(1));
+
+    std::string_view account = accountName(line);
+    // Strip the parentheses/brackets denoting virtual postings
+    if (account.size() >= 2) {
+      char open = account.front();
+      char close = account.back();
+      if ((open == '(' && close == ')') || (open == '[' && close == ']')) {
+	account = trim(account.substr(1, account.size() - 2));
+      }
+    }
+    return account;
+  }
+}
+
+JournalScanner::JournalScanner(std::string journal) {
+  // The journal itself is scanned on this thread, so that an unreadable journal
+  // is reported to the caller. The files it includes are left in the queue
+  std::filesystem::path root{journal};
+  visit(root);
+  Result result = scan(root);
+
+  if (!queue.empty()) {
+    int workers = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::thread> threads;
+    for (int i = 0; i < workers; i++) {
+      threads.emplace_back(&JournalScanner::work, this);
+    }
+    for (auto& thread : threads) thread.join();
+    if (failure) std::rethrow_exception(failure);
+  }
+  for (auto& included : results) {
+    result.accounts.insert(result.accounts.end(),
+	std::make_move_iterator(included.accounts.begin()),
+	std::make_move_iterator(included.accounts.end()));
+    result.files.insert(result.files.end(), included.files.begin(),
+	included.files.end());
+    result.patterns.insert(result.patterns.end(), included.patterns.begin(),
+	included.patterns.end());
+  }
+
+  // Postings reference the same handful of accounts over and over, so sort and
+  // remove duplicates once rather than maintaining a set during the scan
+  accountNames = std::move(result.accounts);
+  std::sort(accountNames.begin(), accountNames.end());
+  auto duplicates = std::unique(accountNames.begin(), accountNames.end());
+  accountNames.erase(duplicates, accountNames.end());
+  scannedFiles = std::move(result.files);
+  includePatterns = std::move(result.patterns);
+}
+
+std::vector<std::string> const& JournalScanner::accounts() const {
+  return accountNames;
+}
+
+std::vector<std::string> const& JournalScanner::files() const {
+  return scannedFiles;
+}
+
+std::vector<std::string> const& JournalScanner::patterns() const {
+  return includePatterns;
+}
+
+void JournalScanner::work() {
+  std::unique_lock lock{queueMutex};
+  while (true) {
+    // A file being scanned may yet queue more, so the queue being empty only
+    // means that the scan is over once no file is being scanned
+    queueChanged.wait(lock, [this] { return !queue.empty() || active == 0; });
+    if (queue.empty()) break;
+    std::filesystem::path file = std::move(queue.front());
+    queue.pop_front();
+    active++;
+    lock.unlock();
+
+    Result result;
+    std::exception_ptr error;
+    try {
+      result = scan(file);
+    } catch (std::runtime_error const& e) {
+      // Ledger itself would reject a journal with a missing include; however,
+      // completing from the accounts that could be found is still useful
+    } catch (...) {
+      error = std::current_exception();
+    }
+
+    lock.lock();
+    results.push_back(std::move(result));
+    if (error && !failure) failure = error;
+    active--;
+    queueChanged.notify_all();
+  }
+}
+
+JournalScanner::Result JournalScanner::scan(std::filesystem::path file) {
+  Profile::Scope scope{"scan journal", file.string()};
+  int descriptor = open(file.c_str(), O_RDONLY);
+  if (descriptor < 0) {
+    throw std::runtime_error("Error: Could not open file " + file.string());
+  }
+  struct stat status;
+  if (fstat(descriptor, &status) < 0) {
+    close(descriptor);
+    throw std::runtime_error("Error: Could not stat file " + file.string());
+  }
+
+  Result result;
+  result.files.push_back(file.string());
+
+  // Map the file rather than reading it through a stream so that lines can be
+  // examined in place without being copied. Note that zero-length mappings are
+  // not permitted
+  std::size_t size = status.st_size;
+  if (size > 0) {
+    void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+    close(descriptor); // The mapping remains valid after closing
+    if (data == MAP_FAILED) {
+      throw std::runtime_error("Error: Could not map file " + file.string());
+    }
+    // Unmapped however the scan ends
+    std::shared_ptr<void const> mapping{data, [size](void const* data) {
+      munmap(const_cast<void*>(data), size);
+    }};
+    posix_madvise(data, size, POSIX_MADV_SEQUENTIAL);
+    std::string_view text{static_cast<char const*>(data), size};
+    scanText(text, file.parent_path(), result);
+  } else {
+    close(descriptor);
+  }
+  return result;
+}
+
+void JournalScanner::scanText(std::string_view text, std::filesystem::path
+    const& directory, Result& result) {
+  // Indented lines are only postings when they follow a transaction header;
+  // those following e.g., an account directive are sub-directives
+  bool inTransaction = false;
+  std::size_t position = 0;
+  while (position < text.size()) {
+    std::size_t end = text.find('\n', position);
+    if (end == std::string_view::npos) end = text.size();
+    std::string_view line = text.substr(position, end - position);
+    position = end + 1;
+    if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+
+    if (line.empty()) {
+      inTransaction = false;
+      continue;
+    }
+
+    if (isBlank(line.front())) {
+      if (inTransaction) {
+	std::string_view account = postingAccount(line);
+	if (!account.empty()) result.accounts.emplace_back(account);
+      }
+      continue;
+    }
+
+    // Regular, automated (=) and periodic (~) transactions
+    char first = line.front();
+    inTransaction = ('0' <= first && first <= '9') || first == '=' ||
+	first == '~';
+    if (inTransaction) continue;
+
+    std::string_view argument;
+    if (directive(line, "account", argument)) {
+      std::string_view account = accountName(argument);
+      if (!account.empty()) result.accounts.emplace_back(account);
+    } else if (directive(line, "include", argument) ||
+	directive(line, "!include", argument)) {
+      result.patterns.push_back((directory / argument).string());
+      for (auto const& included : expand(argument, directory)) {
+	if (!visit(included)) continue;
+	std::lock_guard lock{queueMutex};
+	queue.push_back(included);
+	queueChanged.notify_one();
+      }
+    }
+    // All other directives and top-level comments are of no interest
+  }
+}
+
+std::vector<std::filesystem::path> JournalScanner::expand(std::string_view
+    pattern, std::filesystem::path const& directory) {
+  // Included paths are relative to the including file's directory (appending
+  // an absolute path replaces the directory entirely)
+  std::filesystem::path path = directory / pattern;
+  if (pattern.find_first_of("*?[") == std::string_view::npos) return {path};
+
+  std::vector<std::filesystem::path> paths;
+  glob_t matches;
+  if (glob(path.c_str(), 0, nullptr, &matches) == 0) {
+    for (std::size_t i = 0; i < matches.gl_pathc; i++) {
+      paths.emplace_back(matches.gl_pathv[i]);
+    }
+  }
+  globfree(&matches);
+  return paths;
+}
+
+bool JournalScanner::visit(std::filesystem::path const& file) {
+  std::error_code error;
+  std::filesystem::path canonical = std::filesystem::weakly_canonical(file,
+      error);
+  if (error) canonical = file;
+  std::lock_guard lock{visitedMutex};
+  return visited.insert(canonical).second;
+}
@@ -0,0 +1,66 @@
+#ifndef JOURNAL_SCANNER_H
+#define JOURNAL_SCANNER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <set>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <deque>
+#include <memory>
+#include <exception>
+#include <filesystem>
+#include <stdexcept>
+#include <algorithm>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <glob.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "profile.hpp"
+
+// Discovers the account names used by a Ledger journal. Both account
+// directives and the accounts of transaction postings are harvested, and
+// include directives are followed. Included files are queued and scanned by a
+// pool of threads, one per hardware thread, however many files there are
+class JournalScanner {
+public:
+  JournalScanner(std::string journal);
+  // Sorted and free of duplicates, ready to be bulk-loaded into a trie
+  std::vector<std::string> const& accounts() const;
+  // Every file that was scanned, starting with the journal itself
+  std::vector<std::string> const& files() const;
+  // The paths named by every include directive (which may be globs), so that
+  // files later added to or removed from an include can be noticed
+  std::vector<std::string> const& patterns() const;
+private:
+  struct Result {
+    std::vector<std::string> accounts;
+    std::vector<std::string> files;
+    std::vector<std::string> patterns;
+  };
+  std::mutex visitedMutex;
+  std::set<std::filesystem::path> visited; // Guards against include cycles
+  std::mutex queueMutex; // Guards all of the members below it
+  std::condition_variable queueChanged;
+  std::deque<std::filesystem::path> queue; // Included files yet to be scanned
+  int active = 0; // Number of files being scanned, which may queue more
+  std::vector<Result> results;
+  std::exception_ptr failure;
+  std::vector<std::string> accountNames;
+  std::vector<std::string> scannedFiles;
+  std::vector<std::string> includePatterns;
+  void work();
+  Result scan(std::filesystem::path file);
+  void scanText(std::string_view text, std::filesystem::path const& directory,
+      Result& result);
+  std::vector<std::filesystem::path> expand(std::string_view pattern,
+      std::filesystem::path const& directory);
+  bool visit(std::filesystem::path const& file);
+};
+
+#endif
@@ -0,0 +1,97 @@
+#include "latency_trace.hpp"
+
+namespace {
+  constexpr std::array<char const*, LatencyTrace::PHASE_COUNT> phaseNames = {
+    "transition", "mutation", "search", "hint", "render", "flush", "total"
+  };
+  constexpr int barWidth = 40; // Width of the fullest bucket's bar
+
+  std::int64_t microseconds(std::chrono::steady_clock::duration duration) {
+    using std::chrono::duration_cast;
+    return duration_cast<std::chrono::microseconds>(duration).count();
+  }
+}
+
+void LatencyTrace::start() {
+  active = true;
+  started = Clock::now();
+  last = started;
+  pending = {};
+  marked = {};
+}
+
+void LatencyTrace::mark(Phase phase) {
+  // Work done outside of a keystroke (e.g., setting up the first prompt)
+  if (!active) return;
+  Clock::time_point now = Clock::now();
+  pending[phase] += now - last;
+  marked[phase] = true;
+  last = now;
+}
+
+void LatencyTrace::finish() {
+  if (!active) return;
+  active = false;
+  for (int phase = 0; phase < TOTAL; phase++) {
+    if (marked[phase]) histograms[phase].add(pending[phase]);
+  }
+  histograms[TOTAL].add(last - started);
+}
+
+void LatencyTrace::Histogram::add(Clock::duration sample) {
+  // The bit width of the sample in microseconds is the index of the smallest
+  // power of two it is under
+  std::uint64_t us = std::max<std::int64_t>(microseconds(sample), 0);
+  int bucket = std::min<int>(std::bit_width(us), bucketCount - 1);
+  buckets[bucket]++;
+  count++;
+  total += sample;
+  slowest = std::max(slowest, sample);
+}
+
+std::int64_t LatencyTrace::Histogram::percentile(double fraction) const {
+  std::uint64_t target = fraction * count;
+  std::uint64_t seen = 0;
+  for (int bucket = 0; bucket < bucketCount; bucket++) {
+    seen += buckets[bucket];
+    if (seen > target) return std::int64_t{1} << bucket;
+  }
+  return std::int64_t{1} << (bucketCount - 1);
+}
+
+std::ostream& operator<<(std::ostream& out, LatencyTrace const& trace) {
+  out << "Keystroke latency in microseconds (percentiles are bucket bounds)\n";
+  out << std::left << std::setw(12) << "phase" << std::right;
+  for (char const* heading : {"count", "mean", "p50", "p90", "p99", "max"}) {
+    out << std::setw(10) << heading;
+  }
+  out << '\n';
+
+  for (int phase = 0; phase < LatencyTrace::PHASE_COUNT; phase++) {
+    auto const& histogram = trace.histograms[phase];
+    if (histogram.count == 0) continue;
+    out << std::left << std::setw(12) << phaseNames[phase] << std::right;
+    out << std::setw(10) << histogram.count;
+    out << std::setw(10) << microseconds(histogram.total) / histogram.count;
+    for (double fraction : {0.5, 0.9, 0.99}) {
+      out << std::setw(10) << histogram.percentile(fraction);
+    }
+    out << std::setw(10) << microseconds(histogram.slowest) << '\n';
+  }
+
+  for (int phase = 0; phase < LatencyTrace::PHASE_COUNT; phase++) {
+    auto const& histogram = trace.histograms[phase];
+    if (histogram.count == 0) continue;
+    out << '\n' << phaseNames[phase] << '\n';
+    std::uint64_t fullest = *std::max_element(histogram.buckets.begin(),
+	histogram.buckets.end());
+    for (int bucket = 0; bucket < LatencyTrace::bucketCount; bucket++) {
+      std::uint64_t samples = histogram.buckets[bucket];
+      if (samples == 0) continue;
+      out << "  <" << std::left << std::setw(9) << (std::int64_t{1} << bucket);
+      out << std::right << std::setw(10) << samples << ' ';
+      out << std::string(samples * barWidth / fullest, '#') << '\n';
+    }
+  }
+  return out;
+}
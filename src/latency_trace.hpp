@@ -0,0 +1,54 @@
+#ifndef LATENCY_TRACE_H
+#define LATENCY_TRACE_H
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <bit>
+#include <string>
+#include <ostream>
+#include <iomanip>
+#include <algorithm>
+
+// Records how long each keystroke takes to handle, from the moment wgetch
+// returns until the resulting changes have been flushed to the terminal. The
+// time in between is split into phases, each with its own histogram. Buckets
+// are powers of two microseconds, so recording a sample is a handful of
+// instructions and the histograms are of fixed size however long the session
+class LatencyTrace {
+public:
+  enum Phase {TRANSITION, MUTATION, SEARCH, HINT, RENDER, FLUSH, TOTAL,
+    PHASE_COUNT};
+  // Begins timing a keystroke
+  void start();
+  // Attributes the time since the last mark (or start) to a phase. Phases may
+  // be marked any number of times per keystroke; their times are summed
+  void mark(Phase phase);
+  // Records the keystroke's phases (and their total) in the histograms
+  void finish();
+  // Prints each phase's sample count, mean, percentiles and histogram
+  friend std::ostream& operator<<(std::ostream& out, LatencyTrace const&
+      trace);
+private:
+  typedef std::chrono::steady_clock Clock;
+  // Bucket 0 holds samples under 1us and bucket b those under 2^b us. The last
+  // bucket also holds everything slower
+  static constexpr int bucketCount = 24;
+  struct Histogram {
+    std::array<std::uint64_t, bucketCount> buckets = {};
+    std::uint64_t count = 0;
+    Clock::duration total = {};
+    Clock::duration slowest = {};
+    void add(Clock::duration sample);
+    // Upper bound of the bucket holding the given fraction of samples
+    std::int64_t percentile(double fraction) const;
+  };
+  bool active = false;
+  Clock::time_point started;
+  Clock::time_point last;
+  std::array<Clock::duration, PHASE_COUNT> pending = {};
+  std::array<bool, PHASE_COUNT> marked = {};
+  std::array<Histogram, PHASE_COUNT> histograms;
+};
+
+#endif
@@ -2,6 +2,15 @@
 #include <string>
 #include <filesystem>
 #include <algorithm>
+#include <memory>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string_view>
+#include <vector>
+#include <format>
+#include <optional>
+#include <charconv>
 
 #include <ncurses.h>
 
@@ -11,14 +20,67 @@
 #include "table_array.hpp"
 #include "table_view_array.hpp"
 #include "prompt.hpp"
+#include "input_source.hpp"
 #include "input.hpp"
 #include "formatter.hpp"
+#include "transaction_map.hpp"
+#include "stream_export.hpp"
+#include "profile.hpp"
+#include "memory_stats.hpp"
+
+namespace {
+  // Summarizes the profile and writes its trace, if profiling was requested
+  void reportProfile(std::string const& profileFile) {
+    if (profileFile.empty()) return;
+    Profile::summarize(std::cerr);
+    try {
+      Profile::writeTrace(profileFile);
+      std::cerr << "Info: Wrote trace events to " << profileFile << '\n';
+    } catch (std::runtime_error const& e) {
+      std::cerr << e.what() << '\n';
+    }
+  }
+}
 
 int main(int argc, char* argv[]) {
-  if (argc == 1) {
-    std::cout << "Usage: reconcile csv_file1 [csv_file2 ...]\n";
+  // Options precede the statements
+  std::string replayFile;
+  std::string profileFile;
+  bool exportOnly = false;
+  int chunkRows = StreamExport::defaultChunkRows;
+  int firstStatement = 1;
+  while (firstStatement < argc) {
+    std::string_view option{argv[firstStatement]};
+    if (!option.starts_with("--")) break;
+    firstStatement++;
+    if (option == "--") break;
+    if (option == "--replay" && firstStatement < argc) {
+      replayFile = argv[firstStatement++];
+    } else if (option == "--profile" && firstStatement < argc) {
+      profileFile = argv[firstStatement++];
+    } else if (option == "--export") {
+      exportOnly = true;
+    } else if (option == "--chunk-rows" && firstStatement < argc) {
+      std::string_view rows{argv[firstStatement++]};
+      auto [end, error] = std::from_chars(rows.data(), rows.data() +
+	  rows.size(), chunkRows);
+      if (error != std::errc{} || end != rows.data() + rows.size() ||
+	  chunkRows < 1) {
+	std::cerr << "Error: --chunk-rows expects a positive number of rows, ";
+	std::cerr << "not " << rows << '\n';
+	return 1;
+      }
+    } else {
+      std::cerr << "Error: Unknown option " << option << '\n';
+      return 1;
+    }
+  }
+  if (firstStatement == argc) {
+    std::cout << "Usage: reconcile [--replay script] [--profile trace_file] ";
+    std::cout << "[--export [--chunk-rows rows]] csv_file1 [csv_file2 ...]\n";
     exit(0);
   }
+  if (!profileFile.empty()) Profile::enable();
 
 #ifdef DEBUG
   std::filesystem::path configFile{std::filesystem::current_path() / CONF};
@@ -71,21 +133,101 @@ int main(int argc, char* argv[]) {
   }
 #endif
 
-  toml::table const config = toml::parse_file(configFile.string());
+  toml::table config;
+  {
+    Profile::Scope scope{"parse config", configFile.string()};
+    config = toml::parse_file(configFile.string());
+  }
   std::string dateFormat = config["date_format"].value_or("");
-  StatementImporter importer{config};
+  std::vector<std::string> statements{argv + firstStatement, argv + argc};
+
+  // An export appends the statements' transactions to the output file without
+  // loading them into tables or starting a session, so its memory use is
+  // bounded however many statements there are. Rows are categorized by the
+  // config's rules and then by the transaction map
+  if (exportOnly) {
+#ifdef DEBUG
+    std::filesystem::path transactionMapFile;
+    transactionMapFile = std::filesystem::current_path() / MAP;
+#else
+    std::filesystem::path transactionMapFile;
+    if (char const* home = std::getenv("HOME")) {
+      transactionMapFile = std::filesystem::path{home} / MAP;
+    }
+#endif
+    std::string outputFile{config["output"]["file"].value_or("")};
+    std::ofstream ledgerOutput{outputFile, std::ios_base::app};
+    try {
+      TransactionMap transactionMap{transactionMapFile};
+      StreamExport streamExport{config, transactionMap, chunkRows};
+      std::int64_t written = streamExport.write(statements, ledgerOutput);
+      ledgerOutput.close();
+      if (ledgerOutput.fail()) {
+	throw std::runtime_error("Error: Could not write " + outputFile);
+      }
+      std::cerr << "Info: Exported " << written << " transactions to ";
+      std::cerr << outputFile << '\n';
+    } catch (std::runtime_error const& e) {
+      std::cerr << e.what() << '\n';
+      return 1;
+    }
+    MemoryStats::report(std::cerr);
+    reportProfile(profileFile);
+    return 0;
+  }
 
+  StatementImporter importer{config};
   TableArray tableArray;
-  for (int i = 1; i < argc; i++) {
+  for (int i = firstStatement; i < argc; i++) {
     std::string statement{argv[i]};
-    Descriptor descriptor = importer.descriptor(statement);
+    Descriptor descriptor;
+    {
+      Profile::Scope scope{"find descriptor", statement};
+      descriptor = importer.descriptor(statement);
+    }
+    Profile::Scope scope{"load table", statement};
+    MemoryStats::Tag tag{MemoryStats::TABLE};
     tableArray.push_back(Table{statement, dateFormat, descriptor});
   }
+  MemoryStats::checkpoint("load");
   // Increment iterator to skip header when sorting rows in table
-  for (auto& table : tableArray) std::sort(++table.begin(), table.end());
+  for (auto& table : tableArray) {
+    Profile::Scope scope{"sort table", std::string{table.getAccount().str()}};
+    MemoryStats::Tag tag{MemoryStats::TABLE};
+    std::sort(++table.begin(), table.end());
+  }
+  MemoryStats::checkpoint("sort");
+
+  // A replayed session is drawn to a terminal on /dev/null, so that it runs
+  // through the same rendering as an interactive one without needing a
+  // terminal of its own
+  std::unique_ptr<InputSource> source;
+  if (replayFile.empty()) {
+    source = std::make_unique<TerminalSource>();
+    initscr();
+  } else {
+    try {
+      source = std::make_unique<ScriptSource>(replayFile);
+    } catch (std::runtime_error const& e) {
+      std::cerr << e.what() << '\n';
+      return 1;
+    }
+    FILE* nullTerminal = std::fopen("/dev/null", "r+");
+    if (nullTerminal == nullptr) {
+      std::cerr << "Error: Could not open /dev/null to replay into\n";
+      return 1;
+    }
+    char const* terminal = std::getenv("TERM");
+    SCREEN* screen = newterm(terminal ? terminal : "xterm", nullTerminal,
+	nullTerminal);
+    if (screen == nullptr) {
+      std::cerr << "Error: Could not create a terminal to replay into\n";
+      return 1;
+    }
+  }
+  auto replayStart = std::chrono::steady_clock::now();
 
   // Configure ncurses
-  initscr();
   start_color();
   init_pair(1, COLOR_BLACK, COLOR_WHITE); // Focused row cursor colour pair
   init_pair(2, COLOR_BLACK, 8); // Unfocused row cursor colour pair
@@ -99,38 +241,75 @@ int main(int argc, char* argv[]) {
   //int height = LINES;
   //int width = COLS;
   //getmaxyx(stdscr, height, width);
-  const int promptHeight = 7;
+  const int promptHeight = 8;
   const int tableHeight = LINES - promptHeight;
   //const int commandY = height - commandHeight;
 
-  // TODO: handle terminal resizing
-  // Create windows
+  // Create windows. Their layout is recomputed by Input whenever the terminal
+  // is resized
   WINDOW* tableContent = newwin(tableHeight, COLS, 0, 0);
   WINDOW* promptBorder = newwin(promptHeight, COLS, tableHeight, 0);
-  WINDOW* promptContent = derwin(promptBorder, promptHeight - 2, COLS - 2,
-      1, 1);
-
-  box(promptBorder, 0, 0);
-  wrefresh(promptBorder);
-  keypad(promptContent, TRUE);
 
   TableViewArray tableViewArray{tableArray, tableContent};
-  Prompt prompt{promptContent};
+  Prompt prompt{promptBorder, *source};
 
   std::string accountsFile = config["ledger_accounts"].value_or("");
-  Input input{tableViewArray, prompt, accountsFile};
+  bool appendAccounts = config["append_new_accounts"].value_or(false);
+  Input input{tableViewArray, prompt, statements, accountsFile,
+    appendAccounts};
+  MemoryStats::checkpoint("input");
 
   input.evaluate();
+  MemoryStats::checkpoint("session");
 
   // Open the output file and append Ledger-formatted transactions from tables
   std::string outputFile{config["output"]["file"].value_or("")};
   std::ofstream ledgerOutput{outputFile, std::ios_base::app};
-  ledgerOutput << Formatter{tableArray, *config["output"]["format"].as_table()};
+  {
+    Profile::Scope scope{"format transactions", outputFile};
+    ledgerOutput << Formatter{tableArray,
+      *config["output"]["format"].as_table()};
+    ledgerOutput.close();
+  }
+  MemoryStats::checkpoint("format");
+  // Until the transactions are safely written, the session can be resumed
+  if (!ledgerOutput.fail()) input.discardJournal();
 
   delwin(tableContent);
   delwin(promptBorder);
-  delwin(promptContent);
+  // A replay's screen is left for exit to clean up, since the prompt's windows
+  // are deleted after this point and would be freed along with it
   endwin();
 
+  // Report the replay's throughput from loading the tables into the views
+  // through to writing their transactions out, over the rows the script
+  // actually recorded or skipped
+  if (!replayFile.empty()) {
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() -
+	replayStart;
+    int rows = input.rowsProcessed();
+    std::cerr << "Replayed ";
+    std::cerr << static_cast<ScriptSource&>(*source).replayed() << " keys ";
+    std::cerr << "over " << rows << " rows in " << elapsed.count() << "s (";
+    std::cerr << rows / elapsed.count() << " rows/s)\n";
+  }
+
+  // Check each account's balance against its statement's closing balance, if
+  // one was given, now that every split has been made
+  for (auto& table : tableArray) {
+    std::optional<Amount> closing = table.statedClosingBalance();
+    if (!closing.has_value() || table.balance() == *closing) continue;
+    // TODO: log warning properly
+    std::cerr << "Warning: " << table.getAccount().str() << " closes at ";
+    std::cerr << std::format("{:.2f}", table.balance() / 100.0);
+    std::cerr << " rather than the statement's closing balance of ";
+    std::cerr << std::format("{:.2f}", *closing / 100.0) << '\n';
+  }
+
+  // Reported once the terminal has been restored so that it isn't drawn over
+  if (config["trace_latency"].value_or(false)) std::cerr << input.latency();
+  MemoryStats::report(std::cerr);
+  reportProfile(profileFile);
+
   return 0;
 }
@@ -0,0 +1,214 @@
+#include "memory_stats.hpp"
+
+namespace {
+  constexpr std::array<char const*, MemoryStats::SUBSYSTEM_COUNT>
+      subsystemNames = {
+    "other", "table", "search", "transaction map", "autocomplete"
+  };
+
+  struct Checkpoint {
+    char const* name;
+    std::array<MemoryStats::Counts, MemoryStats::SUBSYSTEM_COUNT> counts;
+  };
+
+  // Checkpoints are only ever taken from the main thread
+  std::vector<Checkpoint>& checkpoints() {
+    static std::vector<Checkpoint> instance;
+    return instance;
+  }
+
+#ifdef MEMSTATS
+  struct Counters {
+    std::atomic<std::int64_t> allocations{0};
+    std::atomic<std::int64_t> allocated{0};
+    std::atomic<std::int64_t> live{0};
+    std::atomic<std::int64_t> peak{0};
+  };
+
+  // Constant-initialized, so they're ready for allocations made during static
+  // initialization
+  constinit std::array<Counters, MemoryStats::SUBSYSTEM_COUNT> counters;
+  constinit thread_local MemoryStats::Subsystem current = MemoryStats::OTHER;
+
+  // Precedes each allocation. Its size keeps the allocations that follow it
+  // aligned for any fundamental type
+  struct alignas(std::max_align_t) Header {
+    std::uint64_t size;
+    std::uint32_t subsystem;
+    std::uint32_t offset; // From the start of the underlying malloc block
+  };
+
+  void* allocate(std::size_t size, std::size_t alignment, bool nothrow) {
+    // Over-aligned allocations pad the header out to their alignment, so that
+    // the header still immediately precedes the returned pointer
+    std::size_t offset = std::max(sizeof(Header), alignment);
+    void* block = nullptr;
+    if (alignment <= alignof(Header)) {
+      block = std::malloc(offset + size);
+    } else if (posix_memalign(&block, alignment, offset + size) != 0) {
+      block = nullptr;
+    }
+    if (block == nullptr) {
+      if (nothrow) return nullptr;
+      throw std::bad_alloc{};
+    }
+
+    char* result = static_cast<char*>(block) + offset;
+    Header* header = reinterpret_cast<Header*>(result) - 1;
+    *header = {size, static_cast<std::uint32_t>(current),
+      static_cast<std::uint32_t>(offset)};
+    Counters& counter = counters[current];
+    counter.allocations.fetch_add(1, std::memory_order_relaxed);
+    counter.allocated.fetch_add(size, std::memory_order_relaxed);
+    std::int64_t live = counter.live.fetch_add(size,
+	std::memory_order_relaxed) + size;
+    std::int64_t peak = counter.peak.load(std::memory_order_relaxed);
+    while (live > peak && !counter.peak.compare_exchange_weak(peak, live,
+	  std::memory_order_relaxed)) {}
+    return result;
+  }
+
+  void deallocate(void* pointer) {
+    if (pointer == nullptr) return;
+    Header* header = static_cast<Header*>(pointer) - 1;
+    counters[header->subsystem].live.fetch_sub(header->size,
+	std::memory_order_relaxed);
+    std::free(static_cast<char*>(pointer) - header->offset);
+  }
+#endif
+}
+
+#ifdef MEMSTATS
+MemoryStats::Tag::Tag(Subsystem subsystem) : previous{current} {
+  current = subsystem;
+}
+
+MemoryStats::Tag::~Tag() { current = previous; }
+
+MemoryStats::Counts MemoryStats::counts(Subsystem subsystem) {
+  Counters const& counter = counters[subsystem];
+  return {
+    .allocations = counter.allocations.load(std::memory_order_relaxed),
+    .allocated = counter.allocated.load(std::memory_order_relaxed),
+    .live = counter.live.load(std::memory_order_relaxed),
+    .peak = counter.peak.load(std::memory_order_relaxed)
+  };
+}
+
+void* operator new(std::size_t size) {
+  return allocate(size, alignof(std::max_align_t), false);
+}
+
+void* operator new[](std::size_t size) {
+  return allocate(size, alignof(std::max_align_t), false);
+}
+
+void* operator new(std::size_t size, std::nothrow_t const&) noexcept {
+  return allocate(size, alignof(std::max_align_t), true);
+}
+
+void* operator new[](std::size_t size, std::nothrow_t const&) noexcept {
+  return allocate(size, alignof(std::max_align_t), true);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+  return allocate(size, static_cast<std::size_t>(alignment), false);
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+  return allocate(size, static_cast<std::size_t>(alignment), false);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment,
+    std::nothrow_t const&) noexcept {
+  return allocate(size, static_cast<std::size_t>(alignment), true);
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment,
+    std::nothrow_t const&) noexcept {
+  return allocate(size, static_cast<std::size_t>(alignment), true);
+}
+
+// The header records everything needed to free an allocation, so each form
+// of delete is the same
+void operator delete(void* pointer) noexcept { deallocate(pointer); }
+
+void operator delete[](void* pointer) noexcept { deallocate(pointer); }
+
+void operator delete(void* pointer, std::size_t) noexcept {
+  deallocate(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t) noexcept {
+  deallocate(pointer);
+}
+
+void operator delete(void* pointer, std::align_val_t) noexcept {
+  deallocate(pointer);
+}
+
+void operator delete[](void* pointer, std::align_val_t) noexcept {
+  deallocate(pointer);
+}
+
+void operator delete(void* pointer, std::size_t, std::align_val_t) noexcept {
+  deallocate(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t, std::align_val_t)
+    noexcept {
+  deallocate(pointer);
+}
+
+void operator delete(void* pointer, std::nothrow_t const&) noexcept {
+  deallocate(pointer);
+}
+
+void operator delete[](void* pointer, std::nothrow_t const&) noexcept {
+  deallocate(pointer);
+}
+#else
+MemoryStats::Tag::Tag(Subsystem) {}
+
+MemoryStats::Tag::~Tag() {}
+
+MemoryStats::Counts MemoryStats::counts(Subsystem) { return {}; }
+#endif
+
+void MemoryStats::checkpoint(char const* name) {
+  if (!enabled()) return;
+  Checkpoint checkpoint{name, {}};
+  for (int subsystem = 0; subsystem < SUBSYSTEM_COUNT; subsystem++) {
+    checkpoint.counts[subsystem] = counts(Subsystem(subsystem));
+  }
+  checkpoints().push_back(checkpoint);
+}
+
+void MemoryStats::report(std::ostream& out) {
+  if (!enabled()) return;
+  out << "Heap usage per subsystem in KiB. Allocations and KiB allocated are ";
+  out << "since the previous checkpoint\n";
+  out << std::left << std::setw(12) << "checkpoint" << std::setw(18);
+  out << "subsystem" << std::right;
+  for (char const* heading : {"live", "peak", "allocs", "allocated"}) {
+    out << std::setw(12) << heading;
+  }
+  out << '\n';
+
+  Checkpoint previous{"", {}};
+  for (Checkpoint const& checkpoint : checkpoints()) {
+    for (int subsystem = 0; subsystem < SUBSYSTEM_COUNT; subsystem++) {
+      Counts const& now = checkpoint.counts[subsystem];
+      Counts const& before = previous.counts[subsystem];
+      if (now.allocations == 0) continue;
+      out << std::left << std::setw(12) << checkpoint.name << std::setw(18);
+      out << subsystemNames[subsystem] << std::right;
+      out << std::setw(12) << now.live / 1024;
+      out << std::setw(12) << now.peak / 1024;
+      out << std::setw(12) << now.allocations - before.allocations;
+      out << std::setw(12) << (now.allocated - before.allocated) / 1024;
+      out << '\n';
+    }
+    previous = checkpoint;
+  }
+}
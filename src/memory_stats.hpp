@@ -0,0 +1,60 @@
+#ifndef MEMORY_STATS_H
+#define MEMORY_STATS_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstddef>
+#include <new>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <ostream>
+#include <iomanip>
+
+// Counts heap allocations per subsystem in builds made with MEMSTATS defined
+// (make memstats), which replace the global operator new and delete. Each
+// allocation is charged to the subsystem tagged on the allocating thread and
+// records its size and subsystem in a small header, so that freeing it later
+// (from anywhere) credits the same subsystem. Checkpoints snapshot the counts
+// at points of interest for the report printed on exit. In other builds the
+// tags and checkpoints do nothing
+class MemoryStats {
+public:
+  enum Subsystem {OTHER, TABLE, SEARCH, TRANSACTION_MAP, AUTOCOMPLETE,
+    SUBSYSTEM_COUNT};
+  // Charges the current thread's allocations to a subsystem for the lifetime
+  // of the tag. Tags nest, so a subsystem calling into another is charged
+  // only for its own allocations
+  class Tag {
+  public:
+    Tag(Subsystem subsystem);
+    Tag(Tag const&) = delete;
+    Tag& operator=(Tag const&) = delete;
+    ~Tag();
+  private:
+    Subsystem previous;
+  };
+  struct Counts {
+    std::int64_t allocations = 0;
+    std::int64_t allocated = 0; // Bytes, including those since freed
+    std::int64_t live = 0; // Bytes
+    std::int64_t peak = 0; // Most live bytes at once
+  };
+  static constexpr bool enabled() {
+#ifdef MEMSTATS
+    return true;
+#else
+    return false;
+#endif
+  }
+  // Snapshots the counts under the given name (e.g., a string literal)
+  static void checkpoint(char const* name);
+  static Counts counts(Subsystem subsystem);
+  // Prints each checkpoint's live and peak bytes per subsystem, and the
+  // allocations made since the previous checkpoint
+  static void report(std::ostream& out);
+};
+
+#endif
@@ -0,0 +1,168 @@
+#include "profile.hpp"
+
+namespace {
+  typedef std::chrono::steady_clock Clock;
+
+  struct Span {
+    char const* name;
+    std::string detail;
+    int thread; // In the order threads first recorded a span, main first
+    Clock::time_point started;
+    Clock::duration duration;
+  };
+
+  class Recorder {
+  public:
+    std::atomic<bool> enabled = false;
+    Clock::time_point epoch = Clock::now(); // Trace timestamps are relative
+
+    // Numbers threads in the order they're first seen
+    int thread(std::thread::id id) {
+      std::lock_guard lock{mutex};
+      return threads.try_emplace(id, threads.size()).first->second;
+    }
+
+    void add(Span span) {
+      span.thread = thread(std::this_thread::get_id());
+      std::lock_guard lock{mutex};
+      spans.push_back(std::move(span));
+    }
+
+    int threadCount() {
+      std::lock_guard lock{mutex};
+      return threads.size();
+    }
+
+    std::vector<Span> recorded() {
+      std::lock_guard lock{mutex};
+      return spans;
+    }
+  private:
+    std::mutex mutex;
+    std::unordered_map<std::thread::id, int> threads;
+    std::vector<Span> spans;
+  };
+
+  Recorder& recorder() {
+    static Recorder instance;
+    return instance;
+  }
+
+  double milliseconds(Clock::duration duration) {
+    return std::chrono::duration<double, std::milli>(duration).count();
+  }
+
+  std::int64_t microseconds(Clock::duration duration) {
+    using std::chrono::duration_cast;
+    return duration_cast<std::chrono::microseconds>(duration).count();
+  }
+
+  std::string escape(std::string_view value) {
+    std::string escaped;
+    for (char c : value) {
+      if (c == '"' || c == '\\') {
+	escaped += '\\';
+	escaped += c;
+      } else if (static_cast<unsigned char>(c) < 0x20) {
+	char code[8];
+	std::snprintf(code, sizeof(code), "\\u%04x", c);
+	escaped += code;
+      } else {
+	escaped += c;
+      }
+    }
+    return escaped;
+  }
+}
+
+Profile::Scope::Scope(char const* name, std::string detail) : name{name},
+    active{recorder().enabled.load(std::memory_order_relaxed)} {
+  if (!active) return;
+  this->detail = std::move(detail);
+  started = Clock::now();
+}
+
+Profile::Scope::~Scope() {
+  if (!active) return;
+  recorder().add({name, std::move(detail), 0, started, Clock::now() -
+      started});
+}
+
+void Profile::enable() {
+  // The main thread enables profiling, so it's the first to be numbered
+  recorder().thread(std::this_thread::get_id());
+  recorder().enabled = true;
+}
+
+bool Profile::enabled() { return recorder().enabled; }
+
+void Profile::summarize(std::ostream& out) {
+  struct Total {
+    int count = 0;
+    Clock::duration total = {};
+    Clock::duration longest = {};
+  };
+  // Keyed by name rather than pointer, since equal literals needn't be merged
+  std::map<std::string_view, Total> totals;
+  for (Span const& span : recorder().recorded()) {
+    Total& total = totals[span.name];
+    total.count++;
+    total.total += span.duration;
+    total.longest = std::max(total.longest, span.duration);
+  }
+  std::vector<std::pair<std::string_view, Total>> phases{totals.begin(),
+    totals.end()};
+  std::stable_sort(phases.begin(), phases.end(), [](auto const& a, auto const&
+	b) {
+    return a.second.total > b.second.total;
+  });
+
+  out << "Phase durations in milliseconds\n";
+  out << std::left << std::setw(28) << "phase" << std::right;
+  for (char const* heading : {"count", "total", "mean", "max"}) {
+    out << std::setw(10) << heading;
+  }
+  out << '\n' << std::fixed << std::setprecision(2);
+  for (auto const& [name, total] : phases) {
+    out << std::left << std::setw(28) << name << std::right;
+    out << std::setw(10) << total.count;
+    out << std::setw(10) << milliseconds(total.total);
+    out << std::setw(10) << milliseconds(total.total) / total.count;
+    out << std::setw(10) << milliseconds(total.longest) << '\n';
+  }
+  out << std::defaultfloat;
+}
+
+void Profile::writeTrace(std::string const& file) {
+  std::vector<Span> spans = recorder().recorded();
+  std::ofstream out{file};
+  out << "{\"traceEvents\":[\n";
+  // Metadata events name each thread's track
+  int threadCount = recorder().threadCount();
+  for (int thread = 0; thread < threadCount; thread++) {
+    if (thread > 0) out << ",\n";
+    out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":";
+    out << thread << ",\"args\":{\"name\":\"";
+    if (thread == 0) {
+      out << "main";
+    } else {
+      out << "worker " << thread;
+    }
+    out << "\"}}";
+  }
+  // Complete events carry their start and duration in microseconds
+  for (Span const& span : spans) {
+    out << ",\n";
+    out << "{\"name\":\"" << escape(span.name) << "\",\"cat\":\"reconcile\",";
+    out << "\"ph\":\"X\",\"pid\":1,\"tid\":" << span.thread << ",\"ts\":";
+    out << microseconds(span.started - recorder().epoch) << ",\"dur\":";
+    out << microseconds(span.duration);
+    if (!span.detail.empty()) {
+      out << ",\"args\":{\"detail\":\"" << escape(span.detail) << "\"}";
+    }
+    out << '}';
+  }
+  out << "\n]}\n";
+  out.close();
+  if (out.fail()) throw std::runtime_error("Error: Could not write " + file);
+}
@@ -0,0 +1,52 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <chrono>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <map>
+#include <fstream>
+#include <ostream>
+#include <iomanip>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdio>
+
+// Scoped timers around the phases of startup and shutdown (e.g., loading
+// tables, building the search index), from any thread. Timers do nothing
+// until profiling is enabled, so they're cheap enough to leave compiled in.
+// Once the program is done, the recorded spans can be summarized per phase or
+// written as Chrome trace events, which chrome://tracing and Perfetto open
+// locally to show each thread's timeline
+class Profile {
+public:
+  // Times the enclosing scope as a span of the named phase. The name must
+  // outlive the profile (e.g., a string literal); details such as a file name
+  // go in detail
+  class Scope {
+  public:
+    Scope(char const* name, std::string detail = "");
+    Scope(Scope const&) = delete;
+    Scope& operator=(Scope const&) = delete;
+    ~Scope();
+  private:
+    char const* name;
+    std::string detail;
+    bool active;
+    std::chrono::steady_clock::time_point started;
+  };
+  static void enable();
+  static bool enabled();
+  // Prints each phase's span count and total, mean and longest duration,
+  // longest total first
+  static void summarize(std::ostream& out);
+  // Writes the spans as a JSON trace event file
+  static void writeTrace(std::string const& file);
+};
+
+#endif
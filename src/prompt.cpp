@@ -1,12 +1,23 @@
 #include "prompt.hpp"
 
 namespace {
-  // For some reason the contents of this string prevent it from being declared
-  // a constexpr
-  const std::string options = " ([account]/[q]uit/[s]kip/[b]ack/spli[t]) ";
+  // Listed on the candidates line rather than after the message, so that the
+  // message (and therefore the field's position) stays short
+  constexpr char const* commands = "[account] [q]uit [s]kip [b]ack spli[t] "
+      "[u]ndo [r]edo [/]search [:]filter";
+  // Lines of the window within the border, beneath the three lines of the row
+  constexpr int balancesLine = 3;
+  constexpr int candidatesLine = 4;
+  constexpr int messageLine = 5;
+  // The message is cut short on narrow terminals to leave the field this much
+  // room
+  constexpr int minimumFieldWidth = 16;
 }
 
-Prompt::Prompt(WINDOW* window) : window{window} {
+Prompt::Prompt(WINDOW* border, InputSource& source) : border{border},
+    borderHeight{getmaxy(border)}, source{source} {
+  layout();
+
   // Allocate new field and corresponding field window with arbitrary
   // height/width and x position. These will be properly set in the draw
   // function
@@ -19,7 +30,7 @@ Prompt::Prompt(WINDOW* window) : window{window} {
   set_form_win(form, window);
   set_form_sub(form, fieldWindow);
   post_form(form);
-  wrefresh(window);
+  wnoutrefresh(window);
 }
 
 Prompt::~Prompt() {
@@ -27,10 +38,11 @@ Prompt::~Prompt() {
   free_form(form);
   free_field(fields[0]);
   delwin(fieldWindow);
+  delwin(window);
 }
 
-void Prompt::amountPrompt(float amount, Row row,
-    std::string hint) {
+void Prompt::amountPrompt(float amount, Row const& row,
+    std::string const& hint) {
   if (amount >= 0) debitPrompt(row);
   else creditPrompt(row);
 
@@ -44,17 +56,36 @@ void Prompt::amountPrompt(float amount, Row row,
   }
 }
 
-void Prompt::splitPrompt(Row row) {
+void Prompt::splitPrompt(Row const& row) {
   draw(row, "What amount should the row being split retain? ", true);
 }
 
+void Prompt::balancePrompt(std::string const& balances) {
+  drawnBalances = balances;
+  wmove(window, balancesLine, 0);
+  wclrtoeol(window);
+  waddnstr(window, balances.c_str(), getmaxx(window));
+  pos_form_cursor(form);
+  wnoutrefresh(window);
+}
+
+void Prompt::flush() {
+  pos_form_cursor(form);
+  wnoutrefresh(window);
+  doupdate();
+}
+
 Prompt::Type Prompt::response(std::string& value) {
   bool read = true;
-  wchar_t inputChar;
+  int inputChar;
   Type responseType;
 
   while (read) {
-    inputChar = wgetch(window);
+    if (!source.next(window, inputChar)) return END;
+
+    // ncurses reports terminal resizes as a key. Return without touching the
+    // field so that its contents (and any hint) survive the relayout
+    if (inputChar == KEY_RESIZE) return RESIZE;
 
     // Reset field colouring to default after first keyboard input is entered
     if (showHint) {
@@ -160,37 +191,129 @@ void Prompt::writeField(std::string contents) {
   form_driver(form, REQ_END_FIELD);
 }
 
-void Prompt::debitPrompt(Row row) {
-  draw(row, "From which account is this amount coming?" + options, false);
+void Prompt::candidatesPrompt(std::vector<std::string> const& candidates, int
+    selected) {
+  int height;
+  int width;
+  getmaxyx(window, height, width);
+
+  // List the candidates in place of the commands, between the balances and the
+  // message, highlighting the selected candidate
+  wmove(window, candidatesLine, 0);
+  wclrtoeol(window);
+  for (int i = 0; i < candidates.size(); i++) {
+    int remaining = width - getcurx(window);
+    if (remaining <= 2) break;
+    if (i > 0) waddstr(window, "  ");
+    if (i == selected) wattr_on(window, A_REVERSE, NULL);
+    waddnstr(window, candidates[i].c_str(), width - getcurx(window));
+    wattr_off(window, A_REVERSE, NULL);
+  }
+  // Return the cursor to the field
+  pos_form_cursor(form);
+  wnoutrefresh(window);
 }
 
-void Prompt::creditPrompt(Row row) {
-  draw(row, "To which account is this amount going?" + options, false);
+int Prompt::height() const { return borderHeight; }
+
+void Prompt::resize(int y, int width) {
+  // Hold on to the field's contents (less the padding) since redrawing the
+  // prompt replaces the field
+  std::string contents{field_buffer(fields[0], 0)};
+  contents.erase(contents.find_last_not_of(' ') + 1);
+
+  // The content and field windows are subwindows, which ncurses can't move
+  // along with their parent, so they are replaced
+  unpost_form(form);
+  delwin(fieldWindow);
+  delwin(window);
+  wresize(border, borderHeight, width);
+  mvwin(border, y, 0);
+  werase(border);
+  layout();
+  fieldWindow = derwin(window, 1, 1, 0, 0);
+  set_form_win(form, window);
+  set_form_sub(form, fieldWindow);
+
+  fieldFitted = false; // The field must be fitted to the new width
+  draw(drawnRow, drawnMessage, drawnNumericInput);
+  if (!contents.empty()) writeField(contents);
+  if (showHint) {
+    set_field_fore(fields[0], COLOR_PAIR(3));
+    set_field_back(fields[0], COLOR_PAIR(3));
+  }
+}
+
+void Prompt::layout() {
+  int width = getmaxx(border);
+  box(border, 0, 0); // Use default border characters
+  wnoutrefresh(border);
+  window = derwin(border, borderHeight - 2, width - 2, 1, 1);
+  keypad(window, TRUE);
+}
+
+void Prompt::debitPrompt(Row const& row) {
+  draw(row, "From which account is this amount coming? ", false);
 }
 
-void Prompt::draw(Row row, std::string message, bool numericInput) {
-  werase(window);
+void Prompt::creditPrompt(Row const& row) {
+  draw(row, "To which account is this amount going? ", false);
+}
+
+void Prompt::draw(Row const& row, std::string const& message, bool
+    numericInput) {
+  // Fitting the field means unposting and reposting the form, which redraws it
+  // from scratch. Prompts alternate between the same few messages, so the field
+  // usually fits already and only the lines above it need redrawing
+  bool reuseField = fieldFitted && message == drawnMessage &&
+      numericInput == drawnNumericInput;
+  drawnRow = row;
+  drawnMessage = message;
+  drawnNumericInput = numericInput;
 
-  fieldPosition = message.size();
   // Construct prompt based on row contents
   std::string border{'+'};
   std::string content{'|'};
-  for (auto cell : row) {
-    std::string formattedCell = cell.as<std::string>();
+  for (auto cell = row.cbegin(); cell != row.cend(); cell++) {
+    std::string formattedCell = cell->as<std::string>();
     border.append(formattedCell.size() + 2, '-');
     border.push_back('+');
     content.append(" " + formattedCell + " |");
   }
 
-  // Move field window out of the way so it doesn't block mvwaddstr output
-  mvderwin(fieldWindow, 3, 0);
+  if (reuseField) {
+    // Leave the message and field lines be
+    for (int y = 0; y < messageLine; y++) {
+      wmove(window, y, 0);
+      wclrtoeol(window);
+    }
+    form_driver(form, REQ_CLR_FIELD);
+  } else {
+    werase(window);
+    int room = std::max(getmaxx(window) - minimumFieldWidth, 0);
+    fieldPosition = std::min<int>(message.size(), room);
+    // Move field window out of the way so it doesn't block mvwaddstr output
+    mvderwin(fieldWindow, candidatesLine, 0);
+    mvwaddnstr(window, messageLine, 0, message.c_str(), fieldPosition);
+    fitField(numericInput);
+  }
 
   // Print constructed prompt
   mvwaddstr(window, 0, 0, border.c_str());
   mvwaddstr(window, 1, 0, content.c_str());
   mvwaddstr(window, 2, 0, border.c_str());
-  mvwaddstr(window, 4, 0, message.c_str());
+  mvwaddnstr(window, balancesLine, 0, drawnBalances.c_str(),
+      getmaxx(window));
+  // Only the account prompts take commands. Completion candidates replace them
+  // until the next prompt is drawn
+  if (!numericInput) {
+    mvwaddnstr(window, candidatesLine, 0, commands, getmaxx(window));
+  }
 
+  wnoutrefresh(window);
+}
+
+void Prompt::fitField(bool numericInput) {
   // Resize field window and FIELD* so that it fills the horizontal prompt
   // window space following the printed message
   unpost_form(form);
@@ -198,17 +321,19 @@ void Prompt::draw(Row row, std::string message, bool numericInput) {
   int height;
   int width;
   getmaxyx(window, height, width);
-  fields[0] = new_field(1, width - fieldPosition, 0, 0, 0, 0);
-  if (numericInput) set_field_type(fields[0], TYPE_NUMERIC, 2, 0, 0);
-  field_opts_off(fields[0], O_AUTOSKIP);
-  field_opts_off(fields[0], O_NULLOK);
+  // ncurses refuses to create a field without width
+  int fieldWidth = std::max(width - fieldPosition, 1);
+  fields[0] = new_field(1, fieldWidth, 0, 0, 0, 0);
   // If we are accepting input after a split prompt (i.e., only numerical input
   // is accepted for the amount field) then set the TYPE_NUMERIC field type
   // before posting the form
-  wresize(fieldWindow, 1, width - fieldPosition);
-  mvderwin(fieldWindow, 4, fieldPosition); // Move field window back into place
+  if (numericInput) set_field_type(fields[0], TYPE_NUMERIC, 2, 0, 0);
+  field_opts_off(fields[0], O_AUTOSKIP);
+  field_opts_off(fields[0], O_NULLOK);
+  wresize(fieldWindow, 1, fieldWidth);
+  // Move field window back into place
+  mvderwin(fieldWindow, messageLine, fieldPosition);
   set_form_fields(form, fields);
   post_form(form);
-
-  wrefresh(window);
+  fieldFitted = true;
 }
@@ -3,31 +3,60 @@
 
 #include <vector>
 #include <string>
+#include <algorithm>
 
 #include <ncurses.h>
 #include <form.h>
 
 #include "row.hpp"
+#include "input_source.hpp"
 
 class Prompt {
 public:
-  enum Type {TAB, ENTER};
-  Prompt(WINDOW* window);
+  // END is returned once the input source has run out of keys
+  enum Type {TAB, ENTER, RESIZE, END};
+  Prompt(WINDOW* border, InputSource& source);
   ~Prompt();
-  void amountPrompt(float amount, Row row, std::string hint = "");
-  void splitPrompt(Row row);
+  void amountPrompt(float amount, Row const& row, std::string const& hint =
+      "");
+  void splitPrompt(Row const& row);
+  // Shows the balances at the row on the line beneath it, where they stay
+  // through later prompts until replaced
+  void balancePrompt(std::string const& balances);
+  // Flushes the changes made to every window since the last flush to the
+  // terminal, leaving the cursor in the field
+  void flush();
   Type response(std::string& value);
   void writeField(std::string contents);
+  void candidatesPrompt(std::vector<std::string> const& candidates, int
+      selected);
+  int height() const;
+  // Moves the prompt to the given line and fits it to the given width,
+  // redrawing it with the field's contents intact
+  void resize(int y, int width);
 private:
+  WINDOW* border;
+  int borderHeight;
+  InputSource& source;
   WINDOW* window;
   WINDOW* fieldWindow;
   FIELD* fields[2];
   FORM* form;
   int fieldPosition = 0;
-  bool showHint;
-  void debitPrompt(Row row);
-  void creditPrompt(Row row);
-  void draw(Row row, std::string message, bool numericInput);
+  bool showHint = false;
+  // The last prompt drawn, so that it can be redrawn after a resize
+  Row drawnRow;
+  std::string drawnMessage;
+  bool drawnNumericInput = false;
+  std::string drawnBalances;
+  // Whether the field fits the message drawn last. If so, drawing a prompt
+  // with the same message reuses the field as it is
+  bool fieldFitted = false;
+  void layout();
+  void debitPrompt(Row const& row);
+  void creditPrompt(Row const& row);
+  void draw(Row const& row, std::string const& message, bool numericInput);
+  void fitField(bool numericInput);
 };
 
 #endif
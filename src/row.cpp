@@ -1,25 +1,46 @@
 #include "row.hpp"
 
-Row::Row() :metadata{Metadata()} {}
+namespace {
+  Row::Version latestVersion = 0;
+}
+
+Row::Row() :metadata{Metadata()}, currentVersion{++latestVersion} {}
 
 Row::Row(std::string line) : Row(line, Metadata()) {}
 
-Row::Row(std::string line, Metadata metadata) : metadata{metadata} {
-  std::stringstream stream{line};
+Row::Row(std::string line, Metadata metadata) : metadata{metadata},
+    currentVersion{++latestVersion} {
+  // Fields may be quoted so that they can contain commas, in which case a pair
+  // of quotes stands for a single quote. Every comma outside of quotes ends a
+  // field, so a trailing comma denotes an empty cell for the last column
   std::string value;
-  for (int i = 0; std::getline(stream, value, ','); i++) {
-    cells.push_back(Cell{value});
-  }
-  // Handle case of trailing comma (denoting an empty cell for the last column)
-  if (line.back() == ',') {
-    cells.push_back(std::string(""));
+  bool quoted = false;
+  for (std::size_t i = 0; i < line.size(); i++) {
+    char c = line[i];
+    if (c == '"') {
+      if (quoted && i + 1 < line.size() && line[i + 1] == '"') {
+	value += c;
+	i++;
+      } else {
+	quoted = !quoted;
+      }
+    } else if (c == ',' && !quoted) {
+      cells.push_back(Cell{value});
+      value.clear();
+    } else {
+      value += c;
+    }
   }
+  cells.push_back(Cell{value});
 
   // Populate any missing formatting strings
   this->metadata.formatting.resize(cells.size());
 }
 
-Cell& Row::operator[](int index) { return cells[index]; }
+Cell& Row::operator[](int index) {
+  currentVersion = ++latestVersion;
+  return cells[index];
+}
 
 Cell const& Row::operator[](int index) const { return cells[index]; }
 
@@ -41,7 +62,10 @@ bool Row::operator<(Row const& other) const {
 
 int Row::size() const { return cells.size(); }
 
-Row::Iterator Row::begin() { return cells.begin(); }
+Row::Iterator Row::begin() {
+  currentVersion = ++latestVersion;
+  return cells.begin();
+}
 
 Row::Iterator Row::end() { return cells.end(); }
 
@@ -50,6 +74,7 @@ Row::ConstIterator Row::cbegin() const { return cells.cbegin(); }
 Row::ConstIterator Row::cend() const { return cells.cend(); }
 
 void Row::push_back(Cell const& value, std::string formatString) { 
+  currentVersion = ++latestVersion;
   cells.push_back(value);
   metadata.formatting.push_back(formatString);
 }
@@ -68,3 +93,5 @@ Row Row::format(std::vector<int> const& columns) const {
   }
   return formattedRow;
 }
+
+Row::Version Row::version() const { return currentVersion; }
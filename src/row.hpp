@@ -5,6 +5,7 @@
 #include <string>
 #include <sstream>
 #include <chrono>
+#include <cstdint>
 
 #include "cell.hpp"
 
@@ -18,9 +19,15 @@ public:
   typedef std::vector<Cell>::iterator Iterator;
   typedef std::vector<Cell>::const_iterator ConstIterator;
 
+  // Versions are unique across all rows, so a version identifies both a row and
+  // the state of its cells
+  typedef std::uint64_t Version;
+
   Row();
   Row(std::string line);
   Row(std::string line, Metadata metadata);
+  // Mutable access gives the row a new version, since it may be used to modify
+  // the cells
   Cell& operator[](int index);
   Cell const& operator[](int index) const;
   // TODO: make non-member function
@@ -33,8 +40,10 @@ public:
   void push_back(Cell const& value, std::string formatString = "");
   Row format() const;
   Row format(std::vector<int> const& columns) const;
+  Version version() const;
 private:
   Metadata metadata;
+  Version currentVersion;
   std::vector<Cell> cells;
 };
 
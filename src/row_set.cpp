@@ -0,0 +1,83 @@
+#include "row_set.hpp"
+
+namespace {
+  constexpr int wordBits = 64;
+}
+
+RowSet::RowSet(int size) : words((size + wordBits - 1) / wordBits),
+    bits{size} {}
+
+int RowSet::size() const { return bits; }
+
+bool RowSet::test(int row) const {
+  return words[row / wordBits] >> (row % wordBits) & 1;
+}
+
+void RowSet::set(int row, bool value) {
+  std::uint64_t bit = std::uint64_t{1} << (row % wordBits);
+  if (value) {
+    words[row / wordBits] |= bit;
+  } else {
+    words[row / wordBits] &= ~bit;
+  }
+}
+
+void RowSet::insert(int row, bool value) {
+  bits++;
+  if (words.size() * wordBits < bits) words.push_back(0);
+
+  // Shift every word above the row's word up a bit, carrying in the top bit of
+  // the word below. Within the row's word, only the bits from the row upwards
+  // move
+  int first = row / wordBits;
+  for (int w = words.size() - 1; w > first; w--) {
+    words[w] = words[w] << 1 | words[w - 1] >> (wordBits - 1);
+  }
+  std::uint64_t below = (std::uint64_t{1} << (row % wordBits)) - 1;
+  std::uint64_t word = words[first];
+  words[first] = (word & below) | (word & ~below) << 1;
+  set(row, value);
+}
+
+void RowSet::erase(int row) {
+  // The reverse of insert. Within the row's word, only the bits above the row
+  // move, and every word above it carries its bottom bit down into the word
+  // below
+  int first = row / wordBits;
+  std::uint64_t below = (std::uint64_t{1} << (row % wordBits)) - 1;
+  std::uint64_t word = words[first];
+  words[first] = (word & below) | (word >> 1 & ~below);
+  for (int w = first + 1; w < words.size(); w++) {
+    words[w - 1] |= words[w] << (wordBits - 1);
+    words[w] >>= 1;
+  }
+  bits--;
+  if ((words.size() - 1) * wordBits >= bits) words.pop_back();
+}
+
+int RowSet::next(int row) const {
+  if (row >= bits) return bits;
+  int w = row / wordBits;
+  // Ignore the bits below the row in its word
+  std::uint64_t word = words[w] & ~std::uint64_t{0} << (row % wordBits);
+  while (word == 0) {
+    if (++w == words.size()) return bits;
+    word = words[w];
+  }
+  // Bits beyond the last row are never set
+  return w * wordBits + std::countr_zero(word);
+}
+
+int RowSet::previous(int row) const {
+  if (row < 0 || bits == 0) return -1;
+  row = std::min(row, bits - 1);
+  int w = row / wordBits;
+  // Ignore the bits above the row in its word
+  std::uint64_t word = words[w] & ~std::uint64_t{0} >> (wordBits - 1 - row %
+      wordBits);
+  while (word == 0) {
+    if (w-- == 0) return -1;
+    word = words[w];
+  }
+  return w * wordBits + wordBits - 1 - std::countl_zero(word);
+}
@@ -0,0 +1,31 @@
+#ifndef ROW_SET_H
+#define ROW_SET_H
+
+#include <vector>
+#include <cstdint>
+#include <bit>
+#include <algorithm>
+
+// A set of row indices stored as a bitset. Finding the next (or previous) row
+// in the set skips over 64 rows at a time, taking the position of the lowest
+// (or highest) set bit of the first non-zero word it comes to
+class RowSet {
+public:
+  RowSet(int size = 0);
+  int size() const;
+  bool test(int row) const;
+  void set(int row, bool value = true);
+  // Inserts a row, shifting the rows at and after it up by one
+  void insert(int row, bool value);
+  // Erases a row, shifting the rows after it down by one
+  void erase(int row);
+  // The first row in the set at or after row, or size() if there is none
+  int next(int row) const;
+  // The last row in the set at or before row, or -1 if there is none
+  int previous(int row) const;
+private:
+  std::vector<std::uint64_t> words;
+  int bits = 0;
+};
+
+#endif
@@ -0,0 +1,45 @@
+#include "rules.hpp"
+
+namespace {
+  namespace Key {
+    constexpr std::string rules = "rules";
+    constexpr std::string pattern = "pattern";
+    constexpr std::string identifier = "identifier";
+    constexpr std::string account = "account";
+  }
+}
+
+Rules::Rules(toml::table const& config) {
+  toml::array const* entries = config[Key::rules].as_array();
+  if (entries == nullptr) return;
+  for (auto const& entry : *entries) {
+    toml::table const* table = entry.as_table();
+    std::string pattern = table ? (*table)[Key::pattern].value_or("") : "";
+    std::string account = table ? (*table)[Key::account].value_or("") : "";
+    if (pattern.empty() || account.empty()) {
+      throw std::runtime_error("Error: Each of the config's rules must have a "
+	  "pattern and an account");
+    }
+    try {
+      rules.push_back({
+	.pattern = std::regex{pattern, std::regex::optimize},
+	.identifier = (*table)[Key::identifier].value_or(""),
+	.account = account
+      });
+    } catch (std::regex_error const& e) {
+      throw std::runtime_error("Error: Invalid rule pattern \"" + pattern +
+	  "\" - " + e.what());
+    }
+  }
+}
+
+std::string_view Rules::match(std::string_view identifier, std::string const&
+    payee) const {
+  for (Rule const& rule : rules) {
+    if (!rule.identifier.empty() && rule.identifier != identifier) continue;
+    if (std::regex_search(payee, rule.pattern)) return rule.account;
+  }
+  return {};
+}
+
+bool Rules::empty() const { return rules.empty(); }
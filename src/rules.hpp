@@ -0,0 +1,33 @@
+#ifndef RULES_H
+#define RULES_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <regex>
+#include <stdexcept>
+
+#include "toml.hpp"
+
+// Categorizes payees by the [[rules]] entries of the config, each of which
+// gives the account for payees matching a regular expression, optionally only
+// in the statements of one account. Rules are tried in the order they appear
+class Rules {
+public:
+  Rules(toml::table const& config);
+  Rules() = default;
+  // The account of the first rule that matches payee in a statement of the
+  // given identifier, or an empty view if none do
+  std::string_view match(std::string_view identifier, std::string const&
+      payee) const;
+  bool empty() const;
+private:
+  struct Rule {
+    std::regex pattern;
+    std::string identifier; // Any statement's if empty
+    std::string account;
+  };
+  std::vector<Rule> rules;
+};
+
+#endif
@@ -0,0 +1,154 @@
+#include "search.hpp"
+
+namespace {
+  constexpr char const* dateFormat = "%Y-%m-%d";
+}
+
+Search::Search(TableArray& tables) : tables{tables} {
+  indexes.resize(tables.size());
+  for (int i = 0; i < tables.size(); i++) {
+    Table const& table = tables[i];
+    pending.push_back(std::async(std::launch::async, [&table] {
+      std::string account{table.getAccount().str()};
+      Profile::Scope scope{"index table", account};
+      return SearchIndex{table};
+    }));
+  }
+}
+
+bool Search::next(std::string_view query, Position from, Position& match) {
+  if (query.empty()) return false;
+
+  // A date is a position in itself, since the rows are sorted by date
+  std::chrono::year_month_day date;
+  if (parseDate(query, date)) {
+    bool found = false;
+    for (int i = 0; i < tables.size(); i++) {
+      Table const& table = tables[i];
+      auto rows = std::views::iota(1, table.length());
+      auto row = std::ranges::partition_point(rows, [&](int row) {
+	return table.getDate(table.cbegin() + row) < date;
+      });
+      if (row == rows.end()) continue;
+      Position position{i, *row};
+      if (!found || order(position) < order(match)) match = position;
+      found = true;
+    }
+    return found;
+  }
+
+  Amount value = 0;
+  bool isSigned = false;
+  bool isAmount = parseAmount(query, value, isSigned);
+
+  // Within a table, the matching rows are in date order, so the first match
+  // following from is found by binary search. Across tables, take the
+  // earliest of those, or else the earliest match of all
+  Order fromOrder = order(from);
+  bool foundAfter = false;
+  bool foundAny = false;
+  Position first;
+  for (int i = 0; i < tables.size(); i++) {
+    std::vector<int> rows = matches(i, query, value, isAmount, isSigned);
+    if (rows.empty()) continue;
+    Position earliest{i, rows.front()};
+    if (!foundAny || order(earliest) < order(first)) first = earliest;
+    foundAny = true;
+
+    auto after = std::ranges::partition_point(rows, [&](int row) {
+      return order({i, row}) <= fromOrder;
+    });
+    if (after == rows.end()) continue;
+    Position position{i, *after};
+    if (!foundAfter || order(position) < order(match)) match = position;
+    foundAfter = true;
+  }
+  if (!foundAfter && foundAny) match = first;
+  return foundAny;
+}
+
+void Search::wait() {
+  for (int i = 0; i < pending.size(); i++) {
+    if (pending[i].valid()) indexes[i] = pending[i].get();
+  }
+}
+
+SearchIndex const& Search::index(int table) {
+  if (pending[table].valid()) indexes[table] = pending[table].get();
+  // Inserting rows (e.g., by splitting one) shifts the rows after them, and
+  // splitting a row changes its amount, so rebuild the index if either has
+  // happened since it was built
+  if (indexes[table].version() != tables[table].contentVersion()) {
+    indexes[table] = SearchIndex{tables[table]};
+  }
+  return indexes[table];
+}
+
+std::vector<int> Search::matches(int table, std::string_view query, Amount
+    value, bool isAmount, bool isSigned) {
+  SearchIndex const& tableIndex = index(table);
+  if (!isAmount) return tableIndex.payee(query);
+
+  // Whether a row's amount is stored as positive or negative depends on the
+  // statement's format, so an unsigned query matches either
+  std::vector<int> rows = tableIndex.amount(value);
+  if (!isSigned && value != 0) {
+    std::vector<int> negated = tableIndex.amount(-value);
+    std::vector<int> merged;
+    std::ranges::merge(rows, negated, std::back_inserter(merged));
+    rows = std::move(merged);
+  }
+  return rows;
+}
+
+Search::Order Search::order(Position position) const {
+  // Rows are visited in date order, with ties going to the leftmost table. A
+  // cursor scrolled past the end of its table is ordered as its last row
+  Table const& table = tables[position.table];
+  int row = std::min(position.row, table.length() - 1);
+  return std::tuple{table.getDate(table.cbegin() + row), position.table,
+      position.row};
+}
+
+bool Search::parseDate(std::string_view query, std::chrono::year_month_day&
+    date) {
+  if (query.size() != 10 || query[4] != '-' || query[7] != '-') return false;
+  std::istringstream dateStream{std::string{query}};
+  date::year_month_day parsed;
+  date::from_stream(dateStream, dateFormat, parsed);
+  if (dateStream.fail() || !parsed.ok()) return false;
+  date = std::chrono::year_month_day{
+    std::chrono::year{static_cast<int>(parsed.year())},
+    std::chrono::month{static_cast<unsigned>(parsed.month())},
+    std::chrono::day{static_cast<unsigned>(parsed.day())}
+  };
+  return true;
+}
+
+bool Search::parseAmount(std::string_view query, Amount& value, bool&
+    isSigned) {
+  isSigned = !query.empty() && (query.front() == '-' || query.front() == '+');
+  bool negative = isSigned && query.front() == '-';
+  if (isSigned) query.remove_prefix(1);
+  if (!query.empty() && query.front() == '$') query.remove_prefix(1);
+
+  // Digits with at most one decimal point, ignoring thousands separators
+  std::string digits;
+  bool point = false;
+  for (char c : query) {
+    if (c == ',') continue;
+    if (c == '.' && !point) {
+      point = true;
+    } else if (c < '0' || '9' < c) {
+      return false;
+    }
+    digits.push_back(c);
+  }
+  if (digits.empty() || digits == ".") return false;
+
+  // Convert the same way as amounts are parsed from the statement, so that
+  // any rounding matches
+  value = Cell{digits}.as<Amount>("{}");
+  if (negative) value = -value;
+  return true;
+}
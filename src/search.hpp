@@ -0,0 +1,57 @@
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <future>
+#include <chrono>
+#include <ranges>
+#include <tuple>
+#include <sstream>
+#include <algorithm>
+
+#include "date.h"
+#include "table.hpp"
+#include "table_array.hpp"
+#include "search_index.hpp"
+#include "profile.hpp"
+
+// Finds rows across all tables by payee substring, exact amount or date. The
+// tables' indexes are built on their own threads as soon as the tables are
+// loaded, so that they are ready (or nearly so) by the first search
+class Search {
+public:
+  struct Position {
+    int table;
+    int row;
+  };
+  Search(TableArray& tables);
+  // Finds the first row matching the query that follows from in date order,
+  // wrapping around to the earliest. A query of the form YYYY-MM-DD finds the
+  // first row on or after that date, a number (optionally preceded by a sign
+  // and/or a dollar sign) finds rows of that amount, and anything else finds
+  // rows by payee. Returns false if no rows match
+  bool next(std::string_view query, Position from, Position& match);
+  // Waits for the indexes to finish building. Must be called before rows are
+  // inserted into any of the tables, which the indexing threads are reading
+  void wait();
+  // Parses an amount as it is written in a query, returning false if the
+  // query isn't an amount. isSigned is set if it begins with a sign
+  static bool parseAmount(std::string_view query, Amount& value, bool&
+      isSigned);
+private:
+  // Date, then table, then row
+  typedef std::tuple<std::chrono::year_month_day, int, int> Order;
+  TableArray& tables;
+  std::vector<std::future<SearchIndex>> pending;
+  std::vector<SearchIndex> indexes;
+  SearchIndex const& index(int table);
+  std::vector<int> matches(int table, std::string_view query, Amount value,
+      bool isAmount, bool isSigned);
+  Order order(Position position) const;
+  static bool parseDate(std::string_view query, std::chrono::year_month_day&
+      date);
+};
+
+#endif
@@ -0,0 +1,91 @@
+#include "search_index.hpp"
+
+namespace {
+  char fold(char c) { return ('A' <= c && c <= 'Z') ? c - 'A' + 'a' : c; }
+}
+
+SearchIndex::SearchIndex(Table const& table) :
+    indexedVersion{table.contentVersion()} {
+  MemoryStats::Tag tag{MemoryStats::SEARCH};
+  // Payees are interned, so grouping rows by payee is a matter of integer
+  // lookups
+  std::unordered_map<Symbol, int> payeeIndices;
+  for (int row = 1; row < table.length(); row++) {
+    Table::ConstIterator position = table.cbegin() + row;
+    Symbol payee = table.getPayee(position);
+    auto [entry, inserted] = payeeIndices.try_emplace(payee, payees.size());
+    if (inserted) {
+      std::string folded{payee.str()};
+      for (char& c : folded) c = fold(c);
+      payees.push_back(std::move(folded));
+      payeeRows.emplace_back();
+    }
+    payeeRows[entry->second].push_back(row);
+
+    try {
+      amounts.push_back({table.amount(position), row});
+    } catch (std::exception const& e) {
+      // A row without an amount simply can't be found by amount
+    }
+  }
+  std::sort(amounts.begin(), amounts.end());
+
+  for (std::uint32_t i = 0; i < payees.size(); i++) {
+    std::string_view payee = payees[i];
+    for (std::size_t j = 0; j + 3 <= payee.size(); j++) {
+      // A trigram may occur several times in a payee but is listed once
+      auto& listed = trigrams[trigram(payee.substr(j, 3))];
+      if (listed.empty() || listed.back() != i) listed.push_back(i);
+    }
+  }
+}
+
+std::vector<int> SearchIndex::payee(std::string_view query) const {
+  std::string folded{query};
+  for (char& c : folded) c = fold(c);
+
+  // Every payee containing the query contains each of its trigrams, so only
+  // those listed under the query's rarest trigram need to be checked. Queries
+  // too short to have a trigram are checked against every payee
+  std::vector<std::uint32_t> all;
+  std::vector<std::uint32_t> const* candidates = &all;
+  if (folded.size() < 3) {
+    for (std::uint32_t i = 0; i < payees.size(); i++) all.push_back(i);
+  } else {
+    for (std::size_t j = 0; j + 3 <= folded.size(); j++) {
+      auto listed = trigrams.find(trigram(std::string_view{folded}.substr(j,
+	      3)));
+      if (listed == trigrams.end()) return {};
+      if (candidates == &all || listed->second.size() < candidates->size()) {
+	candidates = &listed->second;
+      }
+    }
+  }
+
+  std::vector<int> rows;
+  for (std::uint32_t i : *candidates) {
+    if (payees[i].find(folded) == std::string::npos) continue;
+    rows.insert(rows.end(), payeeRows[i].begin(), payeeRows[i].end());
+  }
+  std::sort(rows.begin(), rows.end());
+  return rows;
+}
+
+std::vector<int> SearchIndex::amount(Amount value) const {
+  auto [first, last] = std::equal_range(amounts.begin(), amounts.end(),
+      std::pair<Amount, int>{value, 0}, [](auto const& a, auto const& b) {
+	return a.first < b.first;
+      });
+  std::vector<int> rows;
+  for (auto i = first; i != last; i++) rows.push_back(i->second);
+  // Rows of equal amounts are already sorted by row
+  return rows;
+}
+
+int SearchIndex::version() const { return indexedVersion; }
+
+std::uint32_t SearchIndex::trigram(std::string_view text) {
+  return static_cast<unsigned char>(text[0]) << 16 |
+      static_cast<unsigned char>(text[1]) << 8 |
+      static_cast<unsigned char>(text[2]);
+}
@@ -0,0 +1,43 @@
+#ifndef SEARCH_INDEX_H
+#define SEARCH_INDEX_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <utility>
+#include <cstdint>
+#include <stdexcept>
+
+#include "table.hpp"
+#include "symbol.hpp"
+#include "memory_stats.hpp"
+
+// Indexes of a table's rows by payee and by amount. Rows are sorted by date,
+// so no index is needed to search by date.
+//
+// Many rows share a payee, so the trigram index maps each trigram to the
+// distinct payees containing it rather than to rows. A substring query then
+// only has to check the payees listed under its rarest trigram
+class SearchIndex {
+public:
+  SearchIndex(Table const& table);
+  SearchIndex() = default;
+  // Rows whose payee contains query (case-insensitively), in ascending order
+  std::vector<int> payee(std::string_view query) const;
+  // Rows of the given amount, in ascending order
+  std::vector<int> amount(Amount value) const;
+  // The table's content version that the index was built from
+  int version() const;
+private:
+  int indexedVersion = -1;
+  std::vector<std::string> payees; // Case-folded
+  std::vector<std::vector<int>> payeeRows; // Rows of each payee, ascending
+  // Payees containing each trigram, ascending
+  std::unordered_map<std::uint32_t, std::vector<std::uint32_t>> trigrams;
+  std::vector<std::pair<Amount, int>> amounts; // Sorted
+  static std::uint32_t trigram(std::string_view text);
+};
+
+#endif
@@ -0,0 +1,190 @@
+#include "session_journal.hpp"
+
+namespace {
+  constexpr std::string_view magic{"RCSESSN1"};
+  // An entry's type, table, row and payload length precede its payload, and a
+  // checksum of all of them follows it
+  constexpr int entryHeaderSize = 1 + 2 + 4 + 2;
+  constexpr int checksumSize = 4;
+  constexpr int syncBatch = 32; // Entries appended between syncs
+  constexpr std::chrono::seconds syncInterval{1};
+
+  std::uint64_t fnv1a(std::string_view bytes, std::uint64_t hash =
+      14695981039346656037ull) {
+    for (unsigned char byte : bytes) {
+      hash ^= byte;
+      hash *= 1099511628211ull;
+    }
+    return hash;
+  }
+
+  // Journals never leave the machine they were written on, so integers are
+  // stored in its byte order
+  template <typename T>
+  void put(std::string& bytes, T value) {
+    char buffer[sizeof(T)];
+    std::memcpy(buffer, &value, sizeof(T));
+    bytes.append(buffer, sizeof(T));
+  }
+
+  template <typename T>
+  T get(std::string_view bytes, std::size_t offset) {
+    T value;
+    std::memcpy(&value, bytes.data() + offset, sizeof(T));
+    return value;
+  }
+}
+
+SessionJournal::SessionJournal(std::string path, std::vector<std::string>
+    const& statements) {
+  std::uint64_t hash = fingerprint(statements);
+  char name[17];
+  std::snprintf(name, sizeof(name), "%016llx",
+      static_cast<unsigned long long>(hash));
+  file = path + "." + name;
+  descriptor = open(file.c_str(), O_RDWR | O_CREAT, 0644);
+  if (descriptor < 0) {
+    throw std::runtime_error("Error: Could not open session journal " + file);
+  }
+
+  std::string contents;
+  {
+    std::ifstream in{file, std::ios::binary};
+    std::ostringstream buffer;
+    buffer << in.rdbuf();
+    contents = buffer.str();
+  }
+  std::string header{magic};
+  put(header, hash);
+
+  // Read entries up to the first that is incomplete or corrupt, which is where
+  // an earlier session was cut off mid-write. The file is cut back to the last
+  // good entry so that this session's entries follow on from it
+  std::size_t valid = 0;
+  if (contents.starts_with(header)) {
+    std::string_view bytes{contents};
+    std::size_t offset = header.size();
+    while (offset + entryHeaderSize + checksumSize <= bytes.size()) {
+      std::uint16_t length = get<std::uint16_t>(bytes, offset + 7);
+      std::size_t end = offset + entryHeaderSize + length + checksumSize;
+      if (end > bytes.size()) break;
+      std::string_view body = bytes.substr(offset, entryHeaderSize + length);
+      if (get<std::uint32_t>(bytes, end - checksumSize) !=
+	  static_cast<std::uint32_t>(fnv1a(body))) {
+	break;
+      }
+      Entry entry = {
+	.type = static_cast<Entry::Type>(get<std::uint8_t>(bytes, offset)),
+	.table = get<std::uint16_t>(bytes, offset + 1),
+	.row = static_cast<int>(get<std::uint32_t>(bytes, offset + 3))
+      };
+      std::string_view payload = body.substr(entryHeaderSize);
+      if (entry.type == Entry::RECORD) {
+	entry.account = payload;
+      } else if (entry.type == Entry::SPLIT && length == sizeof(Amount)) {
+	entry.residual = get<Amount>(payload, 0);
+      }
+      entries.push_back(std::move(entry));
+      offset = end;
+    }
+    valid = offset;
+  } else {
+    // A new journal, or one written by an incompatible version
+    if (ftruncate(descriptor, 0) < 0 ||
+	write(descriptor, header.data(), header.size()) != header.size()) {
+      close(descriptor);
+      throw std::runtime_error("Error: Could not write session journal " +
+	  file);
+    }
+    valid = header.size();
+  }
+  if (valid < contents.size()) ftruncate(descriptor, valid);
+  lseek(descriptor, valid, SEEK_SET);
+  lastSync = std::chrono::steady_clock::now();
+}
+
+SessionJournal::SessionJournal(SessionJournal&& other) {
+  std::swap(file, other.file);
+  std::swap(descriptor, other.descriptor);
+  std::swap(entries, other.entries);
+  std::swap(unsynced, other.unsynced);
+  std::swap(lastSync, other.lastSync);
+}
+
+SessionJournal& SessionJournal::operator=(SessionJournal other) {
+  std::swap(file, other.file);
+  std::swap(descriptor, other.descriptor);
+  std::swap(entries, other.entries);
+  std::swap(unsynced, other.unsynced);
+  std::swap(lastSync, other.lastSync);
+  return *this;
+}
+
+SessionJournal::~SessionJournal() {
+  if (descriptor < 0) return;
+  if (unsynced > 0) sync();
+  close(descriptor);
+}
+
+std::vector<SessionJournal::Entry> const& SessionJournal::recovered() const {
+  return entries;
+}
+
+void SessionJournal::append(Entry const& entry) {
+  if (descriptor < 0) return;
+
+  std::string bytes;
+  put<std::uint8_t>(bytes, entry.type);
+  put<std::uint16_t>(bytes, entry.table);
+  put<std::uint32_t>(bytes, entry.row);
+  std::string payload;
+  if (entry.type == Entry::RECORD) payload = entry.account;
+  if (entry.type == Entry::SPLIT) put(payload, entry.residual);
+  put<std::uint16_t>(bytes, payload.size());
+  bytes.append(payload);
+  put<std::uint32_t>(bytes, fnv1a(bytes));
+
+  // A partial write is cut off on the next start, but the entries that follow
+  // it would be too. Stop journaling rather than write entries that can't be
+  // recovered
+  if (write(descriptor, bytes.data(), bytes.size()) != bytes.size()) {
+    // TODO: log warning properly
+    std::cerr << "Warning: Unable to write session journal " << file << " - ";
+    std::cerr << std::strerror(errno) << '\n';
+    close(descriptor);
+    descriptor = -1;
+    return;
+  }
+  unsynced++;
+  if (unsynced >= syncBatch ||
+      std::chrono::steady_clock::now() - lastSync >= syncInterval) {
+    sync();
+  }
+}
+
+void SessionJournal::discard() {
+  if (descriptor >= 0) close(descriptor);
+  descriptor = -1;
+  if (!file.empty()) unlink(file.c_str());
+}
+
+void SessionJournal::sync() {
+  fdatasync(descriptor);
+  unsynced = 0;
+  lastSync = std::chrono::steady_clock::now();
+}
+
+std::uint64_t SessionJournal::fingerprint(std::vector<std::string> const&
+    statements) {
+  // Row positions are only meaningful for the exact statements (in the same
+  // order) that they were recorded against
+  std::uint64_t hash = fnv1a("");
+  for (auto const& statement : statements) {
+    std::ifstream in{statement, std::ios::binary};
+    std::ostringstream contents;
+    contents << in.rdbuf();
+    hash = fnv1a(contents.str(), hash);
+    hash = fnv1a(std::string_view{"\0", 1}, hash);
+  }
+  return hash;
+}
@@ -0,0 +1,72 @@
+#ifndef SESSION_JOURNAL_H
+#define SESSION_JOURNAL_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <cstdio>
+#include <utility>
+#include <iostream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "cell.hpp"
+
+// Append-only binary log of the changes made to the tables during a session,
+// so that a session cut short (e.g., by a crash or a dropped connection) can
+// be resumed where it left off. Each set of statements has its own journal,
+// named for a fingerprint of their contents, which is removed once the
+// session's transactions have been written out.
+//
+// Each entry is written to the file as soon as it is appended, so it survives
+// the process being killed. Syncing it to disk is batched and only happens as
+// entries are appended (and on close), once 32 have built up or a second has
+// passed since the last sync. A power failure can therefore lose up to 31
+// entries, however long ago they were made if the session has since been
+// idle
+class SessionJournal {
+public:
+  struct Entry {
+    // MAPPED marks the point up to which the session's tallies have been
+    // written to the transaction map
+    enum Type : std::uint8_t {RECORD = 1, SPLIT, CURSOR, UNDO, REDO, MAPPED};
+    Type type;
+    int table;
+    int row;
+    std::string account; // Of a RECORD
+    Amount residual = 0; // Of a SPLIT
+  };
+  // Opens the journal for the given statements at path.fingerprint, reading
+  // any entries left by an earlier session
+  SessionJournal(std::string path, std::vector<std::string> const&
+      statements);
+  SessionJournal() = default;
+  SessionJournal(SessionJournal const&) = delete;
+  SessionJournal(SessionJournal&& other);
+  SessionJournal& operator=(SessionJournal other);
+  ~SessionJournal();
+  // Entries left by an earlier session, in the order they were appended
+  std::vector<Entry> const& recovered() const;
+  void append(Entry const& entry);
+  // Removes the journal, since the session it records is complete
+  void discard();
+private:
+  std::string file;
+  int descriptor = -1;
+  std::vector<Entry> entries;
+  int unsynced = 0;
+  std::chrono::steady_clock::time_point lastSync;
+  void sync();
+  static std::uint64_t fingerprint(std::vector<std::string> const&
+      statements);
+};
+
+#endif
@@ -14,6 +14,8 @@ namespace {
     constexpr std::string creditFormat = "credit_format";
     constexpr std::string payeeColumns = "payee_columns";
     constexpr std::string displayColumns = "display_columns";
+    constexpr std::string openingBalance = "opening_balance";
+    constexpr std::string closingBalance = "closing_balance";
   }
 
   namespace Value {
@@ -75,7 +77,10 @@ Descriptor StatementImporter::descriptor(std::string statementFile) {
 	  .debitFormat = table[Key::debitFormat].value_or(""),
 	  .creditFormat = table[Key::creditFormat].value_or(""),
 	  .payeeColumns = arrayToVector(table[Key::payeeColumns].as_array()),
-	  .displayColumns = arrayToVector(table[Key::displayColumns].as_array())
+	  .displayColumns = arrayToVector(
+	      table[Key::displayColumns].as_array()),
+	  .openingBalance = balance(table, Key::openingBalance).value_or(0),
+	  .closingBalance = balance(table, Key::closingBalance)
 	};
 	return d;
       }
@@ -102,3 +107,14 @@ std::vector<int> StatementImporter::arrayToVector(const toml::array* array) {
   });
   return vector;
 }
+
+std::optional<std::int64_t> StatementImporter::balance(toml::table const&
+    table, std::string const& key) {
+  if (!table.contains(key)) return std::nullopt;
+  // Balances are written in dollars, as either integers or floats
+  std::optional<double> dollars = table[key].value<double>();
+  if (!dollars.has_value()) {
+    throw std::runtime_error("Error: Invalid value for " + key);
+  }
+  return std::llround(*dollars * 100);
+}
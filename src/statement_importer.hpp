@@ -5,6 +5,9 @@
 #include <vector>
 #include <stdexcept>
 #include <fstream>
+#include <optional>
+#include <cstdint>
+#include <cmath>
 
 #include "toml.hpp"
 
@@ -21,6 +24,10 @@ struct Descriptor {
   std::string creditFormat;
   std::vector<int> payeeColumns;
   std::vector<int> displayColumns;
+  // Balances of the account before and after the statement's rows, in cents.
+  // The closing balance is only known if it's given in the config
+  std::int64_t openingBalance = 0;
+  std::optional<std::int64_t> closingBalance;
 };
 
 class StatementImporter {
@@ -29,6 +36,8 @@ public:
   Descriptor descriptor(std::string statementFile);
 private:
   std::vector<int> arrayToVector(const toml::array* array);
+  std::optional<std::int64_t> balance(toml::table const& table, std::string
+      const& key);
   std::vector<std::string> identifiers;
   std::map<std::string, toml::table> configsMap;
 };
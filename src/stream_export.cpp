@@ -0,0 +1,255 @@
+#include "stream_export.hpp"
+
+namespace {
+  // Runs merged at once, each with a buffer of its own
+  constexpr int fanIn = 64;
+  constexpr std::size_t bufferSize = 1 << 16;
+  // Tables have a column for the counterparty with this header, and so the
+  // same minimum width
+  constexpr std::string_view categoryHeader = "Destination";
+
+  template<typename T>
+  void writeValue(std::ostream& out, T value) {
+    out.write(reinterpret_cast<char const*>(&value), sizeof(value));
+  }
+
+  template<typename T>
+  bool readValue(std::istream& in, T& value) {
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(&value),
+	  sizeof(value)));
+  }
+
+  void writeString(std::ostream& out, std::string const& value) {
+    writeValue<std::uint32_t>(out, value.size());
+    out.write(value.data(), value.size());
+  }
+
+  bool readString(std::istream& in, std::string& value) {
+    std::uint32_t size;
+    if (!readValue(in, size)) return false;
+    value.resize(size);
+    return static_cast<bool>(in.read(value.data(), size));
+  }
+}
+
+StreamExport::StreamExport(toml::table const& config, TransactionMap const&
+    transactionMap, int chunkRows) : config{config},
+    transactionMap{transactionMap}, rules{config},
+    chunkRows{std::max(chunkRows, 1)} {
+  std::string pattern = (std::filesystem::temp_directory_path() /
+      "reconcile_exportXXXXXX").string();
+  if (mkdtemp(pattern.data()) == nullptr) {
+    throw std::runtime_error("Error: Could not create a temporary directory "
+	"for the export");
+  }
+  directory = pattern;
+}
+
+StreamExport::~StreamExport() {
+  std::error_code error;
+  std::filesystem::remove_all(directory, error);
+}
+
+std::int64_t StreamExport::write(std::vector<std::string> const& statements,
+    std::ostream& out) {
+  StatementImporter importer{config};
+  for (int i = 0; i < statements.size(); i++) {
+    descriptors.push_back(importer.descriptor(statements[i]));
+    amountAlignment = std::max<int>(amountAlignment,
+	descriptors.back().ledgerSource.size());
+    Profile::Scope scope{"spill runs", statements[i]};
+    read(i, statements[i]);
+  }
+
+  // Merge passes reduce the runs until they can all be merged at once. Each
+  // pass merges the oldest runs, so that every record takes part in about as
+  // few passes as possible
+  while (runs.size() > fanIn) {
+    Profile::Scope scope{"merge runs"};
+    std::vector<std::filesystem::path> inputs{runs.begin(), runs.begin() +
+      fanIn};
+    runs.erase(runs.begin(), runs.begin() + fanIn);
+    std::filesystem::path merged = nextRun();
+    std::vector<char> buffer(bufferSize);
+    std::ofstream output;
+    output.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
+    output.open(merged, std::ios::binary);
+    merge(inputs, [&](Record const& record) { writeRecord(output, record); });
+    output.close();
+    if (output.fail()) {
+      throw std::runtime_error("Error: Could not write " + merged.string());
+    }
+    for (auto const& input : inputs) std::filesystem::remove(input);
+    runs.push_back(merged);
+  }
+
+  // Transactions are separated by blank lines, as Formatter separates them
+  Profile::Scope scope{"format transactions"};
+  Formatter formatter{*config["output"]["format"].as_table(), amountAlignment};
+  formatter.prepare(out);
+  std::int64_t written = 0;
+  merge(runs, [&](Record const& record) {
+    Descriptor const& descriptor = descriptors[record.statement];
+    if (written > 0) out << '\n';
+    formatter.formatTransaction(out, {
+      .date = std::chrono::sys_days{std::chrono::days{record.days}},
+      .payee = record.payee,
+      .account = descriptor.ledgerSource,
+      .counterparty = record.counterparty,
+      .amount = record.amount,
+      .normalBalance = descriptor.normalBalance
+    });
+    written++;
+  });
+  return written;
+}
+
+bool StreamExport::Record::operator<(Record const& other) const {
+  // Ties on date keep the order of the statements, and of their rows
+  if (days != other.days) return days < other.days;
+  if (statement != other.statement) return statement < other.statement;
+  return sequence < other.sequence;
+}
+
+StreamExport::RunReader::RunReader(std::filesystem::path const& file) :
+    buffer(bufferSize) {
+  in.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
+  in.open(file, std::ios::binary);
+  if (!in.is_open()) {
+    throw std::runtime_error("Error: Could not open file " + file.string());
+  }
+}
+
+StreamExport::Record const& StreamExport::RunReader::current() const {
+  return record;
+}
+
+bool StreamExport::RunReader::next() { return readRecord(in, record); }
+
+void StreamExport::read(int statement, std::string const& file) {
+  std::ifstream in{file};
+  if (!in.is_open()) {
+    throw std::runtime_error("Error: Could not open file " + file);
+  }
+  Descriptor const& descriptor = descriptors[statement];
+  int lastColumn = std::max({descriptor.dateColumn, descriptor.debitColumn,
+      descriptor.creditColumn});
+  for (int column : descriptor.payeeColumns) {
+    lastColumn = std::max(lastColumn, column);
+  }
+
+  // As with tables, rows follow the first line that looks like CSV (i.e., the
+  // header)
+  std::string line;
+  bool headerFound = false;
+  while (!headerFound && std::getline(in, line)) {
+    headerFound = line.find(',') != std::string::npos;
+  }
+  if (!headerFound) {
+    throw std::runtime_error("Error: CSV formatting could not be detected in " +
+	file);
+  }
+
+  std::vector<Record> chunk;
+  chunk.reserve(chunkRows);
+  std::uint64_t sequence = 0;
+  while (std::getline(in, line)) {
+    if (!line.empty() && line.back() == '\r') line.pop_back();
+    if (line.empty()) continue;
+    Row row{line};
+    if (row.size() <= lastColumn) {
+      // TODO: log warning properly
+      std::cerr << "Warning: Skipping row with too few columns in " << file;
+      std::cerr << " - " << line << '\n';
+      continue;
+    }
+
+    Record record;
+    auto date = row[descriptor.dateColumn].as<std::chrono::year_month_day>(
+	descriptor.dateFormat);
+    record.days = std::chrono::sys_days{date}.time_since_epoch().count();
+    record.statement = statement;
+    record.sequence = sequence++;
+    record.amount = Table::amount(row, descriptor);
+    // Payees spanning several columns are joined as in Table::getPayee
+    for (int column : descriptor.payeeColumns) {
+      record.payee += row[column].as<std::string>("");
+      record.payee += ' ';
+    }
+    if (!record.payee.empty()) record.payee.pop_back();
+
+    // The payee is only looked up rather than interned, since interned strings
+    // are held until the program exits and a payee that was never interned
+    // can't be in the transaction map anyway
+    record.counterparty = rules.match(descriptor.identifier, record.payee);
+    if (record.counterparty.empty()) {
+      Symbol payee = Symbol::lookup(record.payee);
+      if (!payee.empty()) {
+	record.counterparty = transactionMap.getCounterparty(payee).str();
+      }
+    }
+    amountAlignment = std::max({amountAlignment,
+	static_cast<int>(categoryHeader.size()),
+	static_cast<int>(record.counterparty.size())});
+
+    chunk.push_back(std::move(record));
+    if (chunk.size() == chunkRows) spill(chunk);
+  }
+  if (!chunk.empty()) spill(chunk);
+}
+
+void StreamExport::spill(std::vector<Record>& chunk) {
+  std::sort(chunk.begin(), chunk.end());
+  std::filesystem::path run = nextRun();
+  std::vector<char> buffer(bufferSize);
+  std::ofstream out;
+  out.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
+  out.open(run, std::ios::binary);
+  for (Record const& record : chunk) writeRecord(out, record);
+  out.close();
+  if (out.fail()) throw std::runtime_error("Error: Could not write " +
+      run.string());
+  runs.push_back(run);
+  chunk.clear();
+}
+
+void StreamExport::merge(std::vector<std::filesystem::path> const& inputs,
+    std::function<void(Record const&)> const& consume) {
+  std::vector<std::unique_ptr<RunReader>> readers;
+  for (auto const& input : inputs) {
+    auto reader = std::make_unique<RunReader>(input);
+    if (reader->next()) readers.push_back(std::move(reader));
+  }
+
+  // A min-heap of the readers by their current records
+  auto later = [&](int a, int b) {
+    return readers[b]->current() < readers[a]->current();
+  };
+  std::priority_queue<int, std::vector<int>, decltype(later)> heap{later};
+  for (int i = 0; i < readers.size(); i++) heap.push(i);
+  while (!heap.empty()) {
+    int reader = heap.top();
+    heap.pop();
+    consume(readers[reader]->current());
+    if (readers[reader]->next()) heap.push(reader);
+  }
+}
+
+std::filesystem::path StreamExport::nextRun() {
+  return directory / ("run" + std::to_string(runsWritten++));
+}
+
+void StreamExport::writeRecord(std::ostream& out, Record const& record) {
+  writeValue(out, record.days);
+  writeValue(out, record.statement);
+  writeValue(out, record.sequence);
+  writeValue(out, record.amount);
+  writeString(out, record.payee);
+  writeString(out, record.counterparty);
+}
+
+bool StreamExport::readRecord(std::istream& in, Record& record) {
+  return readValue(in, record.days) && readValue(in, record.statement) &&
+      readValue(in, record.sequence) && readValue(in, record.amount) &&
+      readString(in, record.payee) && readString(in, record.counterparty);
+}
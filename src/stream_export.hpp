@@ -0,0 +1,89 @@
+#ifndef STREAM_EXPORT_H
+#define STREAM_EXPORT_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <queue>
+#include <memory>
+#include <fstream>
+#include <ostream>
+#include <filesystem>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <stdexcept>
+#include <iostream>
+#include <algorithm>
+#include <functional>
+
+#include "toml.hpp"
+#include "statement_importer.hpp"
+#include "row.hpp"
+#include "table.hpp"
+#include "transaction_map.hpp"
+#include "rules.hpp"
+#include "formatter.hpp"
+#include "profile.hpp"
+
+// Writes the Ledger transactions of statements without loading them into
+// tables, for exports of more statements than should be held in memory at
+// once. Statements are read in chunks of rows, which are categorized (by the
+// config's rules, then by the transaction map's suggestions), sorted by date
+// and spilled to temporary files as runs. The runs are then merged into a
+// single stream of transactions in date order, a bounded number of runs at a
+// time, so that at most a chunk of rows or a buffered record from each run
+// being merged is ever resident
+class StreamExport {
+public:
+  static constexpr int defaultChunkRows = 100000;
+  StreamExport(toml::table const& config, TransactionMap const&
+      transactionMap, int chunkRows = defaultChunkRows);
+  StreamExport(StreamExport const&) = delete;
+  StreamExport& operator=(StreamExport const&) = delete;
+  // Removes the temporary files
+  ~StreamExport();
+  // Writes the transactions of the statements, returning how many were written
+  std::int64_t write(std::vector<std::string> const& statements, std::ostream&
+      out);
+private:
+  struct Record {
+    std::int32_t days; // Since the epoch
+    std::uint32_t statement;
+    std::uint64_t sequence; // Of the row in its statement
+    Amount amount;
+    std::string payee;
+    std::string counterparty; // Empty if uncategorized
+    bool operator<(Record const& other) const;
+  };
+  // Reads a run's records one at a time
+  class RunReader {
+  public:
+    RunReader(std::filesystem::path const& file);
+    Record const& current() const;
+    // Advances to the next record, returning false at the end of the run
+    bool next();
+  private:
+    std::vector<char> buffer;
+    std::ifstream in;
+    Record record;
+  };
+  toml::table const& config;
+  TransactionMap const& transactionMap;
+  Rules rules;
+  int chunkRows;
+  std::filesystem::path directory;
+  std::vector<std::filesystem::path> runs;
+  int runsWritten = 0;
+  std::vector<Descriptor> descriptors; // Indexed by statement
+  int amountAlignment = 0;
+  void read(int statement, std::string const& file);
+  void spill(std::vector<Record>& chunk);
+  void merge(std::vector<std::filesystem::path> const& inputs,
+      std::function<void(Record const&)> const& consume);
+  std::filesystem::path nextRun();
+  static void writeRecord(std::ostream& out, Record const& record);
+  static bool readRecord(std::istream& in, Record& record);
+};
+
+#endif
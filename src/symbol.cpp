@@ -0,0 +1,73 @@
+#include "symbol.hpp"
+
+namespace {
+  class Pool {
+  public:
+    Pool() { intern(""); } // Reserve id 0 for the empty string
+
+    std::uint32_t intern(std::string_view value) {
+      {
+	std::shared_lock lock{mutex};
+	auto existing = ids.find(value);
+	if (existing != ids.end()) return existing->second;
+      }
+      std::unique_lock lock{mutex};
+      // Another thread may have interned the same string between releasing
+      // the shared lock and acquiring the exclusive one
+      auto existing = ids.find(value);
+      if (existing != ids.end()) return existing->second;
+      std::uint32_t id = strings.size();
+      // std::deque never relocates its elements on push_back, so views into
+      // the stored strings (including the map's keys) remain valid
+      std::string_view stored = strings.emplace_back(value);
+      ids.emplace(stored, id);
+      return id;
+    }
+
+    // Zero if the string has not been interned
+    std::uint32_t find(std::string_view value) {
+      std::shared_lock lock{mutex};
+      auto existing = ids.find(value);
+      return existing == ids.end() ? 0 : existing->second;
+    }
+
+    std::string_view str(std::uint32_t id) {
+      std::shared_lock lock{mutex};
+      return strings[id];
+    }
+  private:
+    std::shared_mutex mutex;
+    std::deque<std::string> strings;
+    std::unordered_map<std::string_view, std::uint32_t> ids;
+  };
+
+  // Function-local static so that symbols may be created during static
+  // initialization of other translation units
+  Pool& pool() {
+    static Pool instance;
+    return instance;
+  }
+}
+
+Symbol::Symbol(std::string_view value) :
+    value{value.empty() ? 0 : pool().intern(value)} {}
+
+Symbol Symbol::lookup(std::string_view value) {
+  Symbol symbol;
+  symbol.value = value.empty() ? 0 : pool().find(value);
+  return symbol;
+}
+
+std::string_view Symbol::str() const {
+  return value == 0 ? std::string_view{} : pool().str(value);
+}
+
+std::uint32_t Symbol::id() const { return value; }
+
+bool Symbol::empty() const { return value == 0; }
+
+std::size_t Symbol::size() const { return str().size(); }
+
+std::ostream& operator<<(std::ostream& out, Symbol const& symbol) {
+  return out << symbol.str();
+}
@@ -0,0 +1,43 @@
+#ifndef SYMBOL_H
+#define SYMBOL_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <functional>
+#include <ostream>
+#include <deque>
+#include <unordered_map>
+#include <shared_mutex>
+#include <mutex>
+
+// An interned string. Each distinct string is stored once in a process-wide
+// pool and referred to by a 32-bit id, so copying, comparing and hashing
+// symbols are integer operations. The default-constructed symbol is the empty
+// string. Note that ids are only meaningful within a single process and must
+// not be persisted
+class Symbol {
+public:
+  Symbol() = default;
+  explicit Symbol(std::string_view value);
+  // The symbol of a string that has already been interned, or the empty
+  // symbol. Unlike the constructor, never adds the string to the pool
+  static Symbol lookup(std::string_view value);
+  std::string_view str() const; // Valid for the lifetime of the program
+  std::uint32_t id() const;
+  bool empty() const;
+  std::size_t size() const;
+  bool operator==(Symbol const& other) const = default;
+  friend std::ostream& operator<<(std::ostream& out, Symbol const& symbol);
+private:
+  std::uint32_t value = 0;
+};
+
+template<>
+struct std::hash<Symbol> {
+  std::size_t operator()(Symbol const& symbol) const noexcept {
+    return std::hash<std::uint32_t>{}(symbol.id());
+  }
+};
+
+#endif
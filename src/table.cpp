@@ -2,7 +2,9 @@
 
 // TODO: Sort table after CSV file is loaded
 Table::Table(std::string statement, std::string globalDateFormat, Descriptor
-    descriptor) : globalDateFormat{globalDateFormat}, descriptor(descriptor) {
+    descriptor) : globalDateFormat{globalDateFormat}, descriptor(descriptor),
+    account{descriptor.ledgerSource} {
+  MemoryStats::Tag tag{MemoryStats::TABLE};
   std::ifstream inputStream{statement};
   if (!inputStream.is_open()) {
     throw std::runtime_error("Error: Could not open file " + statement);
@@ -12,6 +14,8 @@ Table::Table(std::string statement, std::string globalDateFormat, Descriptor
   bool delimiterFound = false;
   std::string line;
   while (std::getline(inputStream, line)) {
+    // Statements downloaded on Windows end their lines with CRLF
+    if (!line.empty() && line.back() == '\r') line.pop_back();
     if (line.find(',') != std::string::npos) {
       delimiterFound = true;
       break;
@@ -46,6 +50,7 @@ Table::Table(std::string statement, std::string globalDateFormat, Descriptor
 
   // Process remainder of file
   while (std::getline(inputStream, line)) {
+    if (!line.empty() && line.back() == '\r') line.pop_back();
     // Parse row, adding a trailing comma to create a category column
     Row row{line + ',', metadata};
 
@@ -58,6 +63,13 @@ Table::Table(std::string statement, std::string globalDateFormat, Descriptor
     Cell parsed{original.as<std::chrono::year_month_day>(format)};
     original = std::move(parsed);
 
+    // Intern payee strings and the (empty) category so that rows share a
+    // single copy of each distinct payee and account name
+    for (int index : descriptor.payeeColumns) {
+      row[index] = Cell{Symbol{row[index].as<std::string>()}};
+    }
+    row[row.size() - 1] = Cell{Symbol{}};
+
     rows.push_back(row);
     
     // Keep track of column widths
@@ -89,10 +101,13 @@ Table& Table::operator+=(Table const& table) {
 	+ descriptor.ledgerSource);
   }
   for (int i = 1; i < table.length(); i++) rows.push_back(table[i]);
+  rowSetsBuilt = false;
+  balancesBuilt = false;
 
   for (int i = 0; i < table.width(); i++) {
     if (table.columnWidth(i) > columnWidths[i]) {
       columnWidths[i] = table.columnWidth(i);
+      currentWidthVersion++;
     }
   }
   return *this;
@@ -100,20 +115,62 @@ Table& Table::operator+=(Table const& table) {
 
 int Table::columnWidth(int column) const { return columnWidths[column]; }
 
+int Table::widthVersion() const { return currentWidthVersion; }
+
+int Table::contentVersion() const { return currentContentVersion; }
+
 std::string Table::formatString(int column) const { return formatting[column]; }
 
 Table::Iterator Table::insert(Table::ConstIterator position, const Row& value) {
-  return rows.insert(position, value);
+  MemoryStats::Tag tag{MemoryStats::TABLE};
+  currentContentVersion++;
+  Iterator inserted = rows.insert(position, value);
+  int row = inserted - rows.begin();
+  updateRowSets(row, true);
+  if (balancesBuilt) {
+    // A row appended to the end joins the last row's slot instead
+    int slot = row < balanceSlots.size() ? balanceSlots[row] :
+	balanceSlots.back();
+    balanceSlots.insert(balanceSlots.begin() + row, slot);
+    balances.add(slot, balanceChange(row));
+  }
+  return inserted;
+}
+
+Table::Iterator Table::erase(Table::ConstIterator position) {
+  currentContentVersion++;
+  int row = position - rows.cbegin();
+  if (balancesBuilt) {
+    balances.add(balanceSlots[row], -balanceChange(row));
+    balanceSlots.erase(balanceSlots.begin() + row);
+  }
+  Row const erased = rows[row];
+  Iterator next = rows.erase(position);
+  if (rowSetsBuilt) {
+    uncategorized.erase(row);
+    debits.erase(row);
+    credits.erase(row);
+  }
+  // Narrow any column the erased row was the widest row of
+  for (int column = 0; column < erased.size(); column++) {
+    updateWidth(column, erased[column].as<std::string>(formatting[column]),
+	"");
+  }
+  return next;
 }
 
 Amount Table::amount(Table::ConstIterator position) const {
+  return amount(*position, descriptor);
+}
+
+Amount Table::amount(Row const& row, Descriptor const& descriptor) {
   if (descriptor.debitColumn == descriptor.creditColumn) {
     // TODO: check that either debit or credit format strings are non-empty
-    Cell cell = (*position)[descriptor.debitColumn];
+    Cell cell = row[descriptor.debitColumn];
     return cell.as<Amount>(descriptor.debitFormat);
   } else {
-    Cell debitCell = (*position)[descriptor.debitColumn];
-    Cell creditCell = (*position)[descriptor.creditColumn];
+    Cell debitCell = row[descriptor.debitColumn];
+    Cell creditCell = row[descriptor.creditColumn];
     if (!debitCell.as<std::string>().empty()) {
       return debitCell.as<Amount>(descriptor.debitFormat);
     } else if (!creditCell.as<std::string>().empty()) {
@@ -143,6 +200,10 @@ void Table::amount(Table::Iterator position, Amount value) {
     complementaryFormat = descriptor.debitFormat;
   }
 
+  currentContentVersion++;
+  int row = position - rows.begin();
+  Amount previous = balancesBuilt ? balanceChange(row) : 0;
+
   // Overwrite existing cell and update column width tracking
   Cell cell{value};
   std::string formattedCell = cell.as<std::string>(format);
@@ -170,6 +231,13 @@ void Table::amount(Table::Iterator position, Amount value) {
       }
     }
   }
+
+  // Both the row sets and the balances read the amount back, so they're only
+  // brought up to date once the complementary cell can't be mistaken for it
+  updateRowSets(row, false);
+  if (balancesBuilt) {
+    balances.add(balanceSlots[row], balanceChange(row) - previous);
+  }
 }
 
 std::chrono::year_month_day Table::getDate(Table::ConstIterator position) const
@@ -178,27 +246,34 @@ std::chrono::year_month_day Table::getDate(Table::ConstIterator position) const
   return cell.as<std::chrono::year_month_day>();
 }
 
-std::string Table::getAccount() const { return descriptor.ledgerSource; }
+Symbol Table::getAccount() const { return account; }
 
-std::string Table::getCounterparty(Table::ConstIterator position) const {
-  return (*position)[rows[0].size() - 1].as<std::string>();
+Symbol Table::getCounterparty(Table::ConstIterator position) const {
+  return (*position)[rows[0].size() - 1].as<Symbol>();
 }
 
-void Table::setCounterparty(Table::Iterator position, std::string value) {
+void Table::setCounterparty(Table::Iterator position, Symbol value) {
+  MemoryStats::Tag tag{MemoryStats::TABLE};
   int column = rows[0].size() - 1;
-  Cell cell{value};
   Cell& existingCell = (*position)[column];
-  updateWidth(column, existingCell.as<std::string>(), cell.as<std::string>());
-  existingCell = cell;
+  std::string existing{existingCell.as<Symbol>().str()};
+  updateWidth(column, existing, std::string{value.str()});
+  existingCell = Cell{value};
+  updateRowSets(position - rows.begin(), false);
 }
 
-std::string Table::getPayee(Table::ConstIterator position) const {
+Symbol Table::getPayee(Table::ConstIterator position) const {
+  // The common case of a single payee column needs no concatenation
+  if (descriptor.payeeColumns.size() == 1) {
+    return (*position)[descriptor.payeeColumns[0]].as<Symbol>();
+  }
   std::string payee;
   for (auto index : descriptor.payeeColumns) {
-    payee += (*position)[index].as<std::string>() + ' ';
+    payee.append((*position)[index].as<Symbol>().str());
+    payee.push_back(' ');
   }
   if (!payee.empty()) payee.pop_back();
-  return payee;
+  return Symbol{payee};
 }
 
 Table::Iterator Table::begin() { return rows.begin(); }
@@ -221,10 +296,129 @@ std::vector<int> const& Table::displayColumns() {
   return descriptor.displayColumns;
 }
 
+RowSet const& Table::uncategorizedRows() {
+  buildRowSets();
+  return uncategorized;
+}
+
+RowSet const& Table::debitRows() {
+  buildRowSets();
+  return debits;
+}
+
+RowSet const& Table::creditRows() {
+  buildRowSets();
+  return credits;
+}
+
+RowSet Table::rowsAbove(Amount threshold) const {
+  RowSet result{length()};
+  for (int row = 1; row < length(); row++) {
+    try {
+      Amount value = amount(cbegin() + row);
+      if (value > threshold || -value > threshold) result.set(row);
+    } catch (std::exception const& e) {
+      // Rows without an amount are never above the threshold
+    }
+  }
+  return result;
+}
+
+Amount Table::balance(int row) {
+  buildBalances();
+  int slot = balanceSlots[row];
+  Amount result = descriptor.openingBalance + balances.prefix(slot + 1);
+  // The tree only sums whole slots, so take off the rows after this one that
+  // share its slot
+  for (int later = row + 1; later < length() && balanceSlots[later] == slot;
+      later++) {
+    result -= balanceChange(later);
+  }
+  return result;
+}
+
+Amount Table::balance(std::chrono::year_month_day date, bool inclusive) {
+  // Rows are sorted by date, so those up to the date are found by bisection
+  ConstIterator end = std::partition_point(cbegin() + 1, cend(),
+      [&](Row const& row) {
+	Cell const& cell = row[descriptor.dateColumn];
+	auto rowDate = cell.as<std::chrono::year_month_day>();
+	return rowDate < date || (inclusive && rowDate == date);
+      });
+  return balance(end - cbegin() - 1);
+}
+
+Amount Table::balance() {
+  buildBalances();
+  return descriptor.openingBalance + balances.prefix(balances.size());
+}
+
+std::optional<Amount> Table::statedClosingBalance() const {
+  return descriptor.closingBalance;
+}
+
+void Table::buildRowSets() {
+  if (rowSetsBuilt) return;
+  uncategorized = RowSet{length()};
+  debits = RowSet{length()};
+  credits = RowSet{length()};
+  rowSetsBuilt = true;
+  for (int row = 1; row < length(); row++) updateRowSets(row, false);
+}
+
+void Table::buildBalances() {
+  if (balancesBuilt) return;
+  std::vector<Amount> changes(length());
+  for (int row = 1; row < length(); row++) changes[row] = balanceChange(row);
+  balances = FenwickTree{changes};
+  balanceSlots = std::vector<int>(length());
+  std::iota(balanceSlots.begin(), balanceSlots.end(), 0);
+  balancesBuilt = true;
+}
+
+Amount Table::balanceChange(int row) const {
+  // The header row and rows without an amount leave the balance as it was
+  if (row == 0) return 0;
+  try {
+    return amount(cbegin() + row);
+  } catch (std::exception const& e) {
+    return 0;
+  }
+}
+
+void Table::updateRowSets(int row, bool inserted) {
+  if (!rowSetsBuilt) return;
+  // The header row is never in a set
+  ConstIterator position = cbegin() + row;
+  bool isUncategorized = row > 0 && getCounterparty(position).empty();
+  bool isDebit = false;
+  bool isCredit = false;
+  if (row > 0) {
+    try {
+      // Mirrors the choice of column in amount
+      Amount value = amount(position);
+      isDebit = value >= 0;
+      isCredit = value < 0;
+    } catch (std::exception const& e) {
+      // Rows without an amount are neither debits nor credits
+    }
+  }
+  if (inserted) {
+    uncategorized.insert(row, isUncategorized);
+    debits.insert(row, isDebit);
+    credits.insert(row, isCredit);
+  } else {
+    uncategorized.set(row, isUncategorized);
+    debits.set(row, isDebit);
+    credits.set(row, isCredit);
+  }
+}
+
 void Table::updateWidth(int column, std::string existing, std::string value) {
   // Update the column's width, if necessary, before inserting the value into
   // the cell
   int& columnWidth = columnWidths[column];
+  int previousWidth = columnWidth;
   if (value.size() > columnWidth) {
     columnWidth = value.size();
   } else if (existing.size() == columnWidth && value.size() < columnWidth) {
@@ -241,4 +435,5 @@ void Table::updateWidth(int column, std::string existing, std::string value) {
     }
     columnWidth = newMaxWidth;
   }
+  if (columnWidth != previousWidth) currentWidthVersion++;
 }
@@ -6,9 +6,15 @@
 #include <fstream>
 #include <stdexcept>
 #include <chrono>
+#include <optional>
+#include <numeric>
 
 #include "statement_importer.hpp"
 #include "row.hpp"
+#include "symbol.hpp"
+#include "row_set.hpp"
+#include "fenwick_tree.hpp"
+#include "memory_stats.hpp"
 
 class Table {
 public:
@@ -22,16 +28,24 @@ public:
   Row const& operator[](int index) const;
   Table& operator+=(Table const& table);
   Iterator insert(ConstIterator position, const Row& value);
+  Iterator erase(ConstIterator position);
   int columnWidth(int column) const;
+  // Changes whenever any column's width changes
+  int widthVersion() const;
+  // Changes whenever rows are inserted, erased or their amounts are changed
+  int contentVersion() const;
   // TODO: potentially move out of Table class
   std::string formatString(int column) const;
   Amount amount(ConstIterator position) const;
   void amount(Iterator position, Amount value);
+  // The amount of a row of a statement with the given descriptor, for rows
+  // read outside of a table
+  static Amount amount(Row const& row, Descriptor const& descriptor);
   std::chrono::year_month_day getDate(ConstIterator position) const;
-  std::string getAccount() const;
-  std::string getCounterparty(ConstIterator position) const;
-  void setCounterparty(Iterator position, std::string value);
-  std::string getPayee(ConstIterator position) const;
+  Symbol getAccount() const;
+  Symbol getCounterparty(ConstIterator position) const;
+  void setCounterparty(Iterator position, Symbol value);
+  Symbol getPayee(ConstIterator position) const;
   Iterator begin(); // Don't hold reference, may be invalidated
   Iterator end(); // Don't hold reference, may be invalidated
   ConstIterator cbegin() const; // Don't hold reference, may be invalidated
@@ -39,13 +53,49 @@ public:
   std::string identifier() const;
   Descriptor::AccountKind normalBalance() const;
   std::vector<int> const& displayColumns();
+  // Sets of rows kept up to date as rows are categorized, split and inserted.
+  // They are built on first use, since rows are sorted after being loaded
+  RowSet const& uncategorizedRows();
+  RowSet const& debitRows();
+  RowSet const& creditRows();
+  // Rows whose amount's magnitude exceeds threshold
+  RowSet rowsAbove(Amount threshold) const;
+  // The running balance of the account after a row: the opening balance (that
+  // of the header row) plus the rows' signed amounts. Formatter takes positive
+  // amounts to be on the side of the account's normal balance, so the balance
+  // is the one the statement would show. Like the row sets, the balances are
+  // built on first use
+  Amount balance(int row);
+  // The balance after the last row dated before date (or on it, if inclusive)
+  Amount balance(std::chrono::year_month_day date, bool inclusive);
+  Amount balance(); // After every row
+  // The closing balance given for the statement in the config, if any
+  std::optional<Amount> statedClosingBalance() const;
 private:
+  void buildRowSets();
+  void buildBalances();
+  Amount balanceChange(int row) const;
+  void updateRowSets(int row, bool inserted);
   void updateWidth(int column, std::string existing, std::string value);
   std::string globalDateFormat;
   Descriptor descriptor;
+  Symbol account;
   std::vector<int> columnWidths;
+  int currentWidthVersion = 0;
+  int currentContentVersion = 0;
   std::vector<std::string> formatting;
   std::vector<Row> rows;
+  bool rowSetsBuilt = false;
+  RowSet uncategorized;
+  RowSet debits;
+  RowSet credits;
+  bool balancesBuilt = false;
+  // The tree holds a slot per row as the table was when the balances were
+  // built. Rows inserted since share the slot of the row they were inserted
+  // before (and so rows split from one another share a slot), which keeps
+  // every change to the balances a single O(log n) update
+  FenwickTree balances;
+  std::vector<int> balanceSlots; // Indexed by row
 };
 
 #endif
@@ -17,12 +17,31 @@ TableArray::ConstIterator TableArray::cbegin() const { return tables.cbegin(); }
 
 TableArray::ConstIterator TableArray::cend() const { return tables.cend(); }
 
-void TableArray::push_back(Table const& value) {
+void TableArray::push_back(Table value) {
   for (auto& table : tables) {
     if (value.identifier() == table.identifier()) {
       table += value;
       return;
     }
   }
-  tables.push_back(value);
+  tables.push_back(std::move(value));
+}
+
+Amount TableArray::netBalance(int table, int row) {
+  std::chrono::year_month_day date;
+  date = tables[table].getDate(tables[table].cbegin() + row);
+  Amount net = 0;
+  for (int index = 0; index < size(); index++) {
+    Table& other = tables[index];
+    Amount balance;
+    if (index == table) {
+      balance = other.balance(row);
+    } else {
+      // Rows on the same date are written table by table, so those of earlier
+      // tables come before the row and those of later tables after it
+      balance = other.balance(date, index < table);
+    }
+    net += other.normalBalance() == Descriptor::DEBIT ? balance : -balance;
+  }
+  return net;
 }
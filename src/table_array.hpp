@@ -3,6 +3,7 @@
 
 #include <vector>
 #include <string>
+#include <utility>
 
 #include "table.hpp"
 
@@ -19,7 +20,12 @@ public:
   Iterator end();
   ConstIterator cbegin() const;
   ConstIterator cend() const;
-  void push_back(Table const& value);
+  void push_back(Table value); // Moved in, unless merged into a table
+  // The combined balance of every table's account after a row, with the rows
+  // of all tables taken in date order (as Formatter writes them). Balances of
+  // accounts with a credit normal balance count against it, so that it's the
+  // net of assets less liabilities
+  Amount netBalance(int table, int row);
 private:
   std::vector<Table> tables;
 };
@@ -3,6 +3,13 @@
 namespace {
   constexpr std::string columnDivider = " | ";
   constexpr int columnSpacing = 3;
+  // Rendered lines of edited rows are never looked up again, so the cache is
+  // emptied once it grows well beyond what scrolling back and forth revisits
+  constexpr std::size_t lineCacheLimit = 4096;
+  // Rows are rendered into the pad in blocks of at least this many rows, and
+  // the pad holds several blocks
+  constexpr int padBlockRows = 256;
+  constexpr int padBlocks = 4;
 }
 
 TableView::TableView(Table& table, WINDOW* window) : table{table},
@@ -11,13 +18,14 @@ TableView::TableView(Table& table, WINDOW* window) : table{table},
   // Reserve first two lines for column headers and header divider
   height -= 2;
 
+  allocatePad();
   refresh(); // Refresh initializes tail to the correct value
 }
 
 std::string TableView::operator[](int index) {
   // The same index shall return the same element between TableViews and their
   // respective Tables
-  return view[index - head];
+  return rowView(table[index]);
 }
 
 void TableView::scrollUp() {
@@ -27,14 +35,13 @@ void TableView::scrollUp() {
   index--;
 
   int cursorIndex = index - head;
-  int midpoint = view.size() / 2 + 1;
+  int midpoint = (tail - head) / 2 + 1;
 
   // Don't scroll down if the top of the table is already in view or if the
   // cursor hasn't yet reached the midpoint of the view
   if (head > 1 && cursorIndex <= midpoint) {
     tail--;
-    view.pop_back();
-    view.push_front(rowView(table[--head]));
+    head--;
   }
 }
 
@@ -52,87 +59,229 @@ void TableView::scrollDown() {
   index++;
 
   int cursorIndex = index - head;
-  int midpoint = view.size() / 2 + 1;
+  int midpoint = (tail - head) / 2 + 1;
 
   // Don't scroll down if the bottom of the table is already in view or if the
   // cursor hasn't yet reached the midpoint of the view
   if (tail < table.length() && cursorIndex >= midpoint) {
     head++;
-    view.pop_front();
-    // Post-increment tail so that when the view is scrolled to its bottom-most
-    // position (i.e., when tail is incremented such that it is equal to
-    // table.lenght()), we don't accidentally perform an out-of-bounds access
-    view.push_back(rowView(table[tail++]));
+    tail++;
   }
 }
 
 int TableView::cursorIndex() const { return index; }
 
+void TableView::seek(int row) {
+  index = row;
+  int viewSize = tail - head;
+  int cursor = std::min(index, table.length() - 1);
+  head = std::clamp(cursor - viewSize / 2, 1, std::max(1, table.length() -
+	viewSize));
+  tail = head + viewSize;
+}
+
 void TableView::draw() {
-  werase(window);
-  mvwprintw(window, 0, 0, "%s", formattedHeaders.c_str());
+  // Headers aren't allowed to wrap, since the divider is no longer reprinted
+  // over them. The line is cleared before printing since printing up to the
+  // window's edge moves the cursor to the following line
+  if (drawnHeaders != formattedHeaders) {
+    drawnHeaders = formattedHeaders;
+    wmove(window, 0, 0);
+    wclrtoeol(window);
+    waddnstr(window, formattedHeaders.c_str(), width);
+    std::string divider(width, '-');
+    mvwaddnstr(window, 1, 0, divider.c_str(), width);
+    wnoutrefresh(window);
+  }
 
-  // Print header divider (overwrites any portion of the headers that may have
-  // been wrapped to the second line if the screen is too small)
-  mvwprintw(window, 1, 0, "%s", std::string{}.append(width, '-').c_str());
-  // Print each row of the view, highlighting the row pointed to by the cursor
-  int cursorIndex = index - head;
-  for (int i = 0; i < view.size(); i++) {
-    if (i == cursorIndex) {
-      if (focus) {
-	wattr_on(window, COLOR_PAIR(1), NULL);
-      } else {
-	wattr_on(window, COLOR_PAIR(2), NULL);
-      }
-    } else {
-      wattr_off(window, COLOR_PAIR(1), NULL);
-      wattr_off(window, COLOR_PAIR(2), NULL);
+  // If the rows on screen have moved beyond the pad (even partly), then move
+  // the pad so that it begins a block before them and render them again
+  int last = std::min(head + height, table.length());
+  if (head < padStart || head + height > padStart + padRows) {
+    padStart = std::max(1, head - blockRows);
+    werase(pad.get());
+    highlightedRow = 0;
+    renderedBegin = head;
+    renderedEnd = head;
+  } else if (head > renderedEnd || last < renderedBegin) {
+    renderedBegin = head;
+    renderedEnd = head;
+  }
+
+  // Render the rows on screen that haven't been, along with the rest of their
+  // block in the direction of the scroll. Then re-render those that have been
+  // edited since being rendered
+  if (head < renderedBegin) {
+    int blockBegin = std::max(renderedBegin - blockRows, padStart);
+    renderRows(std::min(head, blockBegin), renderedBegin);
+    renderedBegin = std::min(head, blockBegin);
+  }
+  if (renderedEnd < last) {
+    int blockEnd = std::min({renderedEnd + blockRows, padStart + padRows,
+	table.length()});
+    renderRows(renderedEnd, std::max(last, blockEnd));
+    renderedEnd = std::max(last, blockEnd);
+  }
+  for (int row = head; row < last; row++) {
+    if (table[row].version() != padVersions[row - padStart]) {
+      renderRows(row, row + 1);
     }
-    mvwprintw(window, i + 2, 0, "%s", view[i].c_str());
-  }
-  // If the cursor index is equal to view.size()-1 (i.e., last index of view
-  // deque), then the COLOR_PAIR highlighting will be left on, since there are
-  // no remaining indicies for which the else clause of the above block will be
-  // triggered. Thus, we turn them off here as a catch-all
-  wattr_off(window, COLOR_PAIR(1), NULL);
-  wattr_off(window, COLOR_PAIR(2), NULL);
-  wrefresh(window);
+  }
+
+  // Highlight the row pointed to by the cursor (unless the cursor has been
+  // scrolled past the end of the table)
+  int colourPair = focus ? 1 : 2;
+  if (index < table.length()) {
+    highlight(index, colourPair);
+  } else {
+    highlight(0, 0);
+  }
+
+  // Only copy the shown part of the pad to the virtual screen; the terminal is
+  // updated once for every window when the next input is read
+  int top;
+  int left;
+  getbegyx(window, top, left);
+  pnoutrefresh(pad.get(), head - padStart, 0, top + 2, left, top + 2 + height
+      - 1, left + width - 1);
 }
 
 void TableView::refresh() {
-  // Refresh header row (in case column widths have changed)
-  formattedHeaders.clear();
-  Row headers = table[0].format();
-  // Format header row by adding padding and column dividers
-  for (int i : table.displayColumns()) {
-    auto formattedHeader = headers[i].as<std::string>();
-    formattedHeaders.append(formattedHeader);
-    int padding = table.columnWidth(i) - formattedHeader.size();
-    formattedHeaders.append(padding, ' ');
-    formattedHeaders.append(columnDivider);
-  }
-  // Replace trailing column divider with blank spaces
-  int position = formattedHeaders.size() - columnSpacing;
-  formattedHeaders.replace(position, columnSpacing, columnSpacing, ' ');
-
-  // Refresh view contents with rows from table
-  view.clear();
+  // Refresh header row if column widths have changed
+  if (headersWidthVersion != table.widthVersion()) {
+    headersWidthVersion = table.widthVersion();
+    formattedHeaders.clear();
+    Row headers = table[0].format();
+    // Format header row by adding padding and column dividers
+    for (int i : table.displayColumns()) {
+      auto formattedHeader = headers[i].as<std::string>();
+      formattedHeaders.append(formattedHeader);
+      int padding = table.columnWidth(i) - formattedHeader.size();
+      formattedHeaders.append(padding, ' ');
+      formattedHeaders.append(columnDivider);
+    }
+    // Replace trailing column divider with blank spaces
+    int position = formattedHeaders.size() - columnSpacing;
+    formattedHeaders.replace(position, columnSpacing, columnSpacing, ' ');
+  }
+
+  // Every rendered row is padded to the column widths, so a width change
+  // requires them all to be rendered again. Otherwise, draw only renders the
+  // rows that have been edited
+  if (padWidthVersion != table.widthVersion()) {
+    padWidthVersion = table.widthVersion();
+    renderedBegin = head;
+    renderedEnd = head;
+  }
+
   // Number of remaining rows in table less the header row
   int rowsRemaining = table.length() - 1;
   int viewSize = height > rowsRemaining ? rowsRemaining : height;
-  for (tail = head; tail < head + viewSize; tail++) {
-    view.push_back(rowView(table[tail]));
-  }
+  tail = head + std::max(viewSize, 0);
 }
 
-std::string TableView::rowView(Row const& row) {
-  Row formattedRow = row.format();
-  std::string rowView;
-  for (int i : table.displayColumns()) {
+std::string const& TableView::rowView(Row const& row) {
+  // Every line is padded to the column widths, so a width change invalidates
+  // all of them
+  if (linesWidthVersion != table.widthVersion() ||
+      lines.size() >= lineCacheLimit) {
+    lines.clear();
+    linesWidthVersion = table.widthVersion();
+  }
+  auto [line, inserted] = lines.try_emplace(row.version());
+  if (!inserted) return line->second;
+
+  // Only format the displayed columns
+  std::vector<int> const& columns = table.displayColumns();
+  Row formattedRow = row.format(columns);
+  std::string& rowView = line->second;
+  for (int i = 0; i < columns.size(); i++) {
     auto formattedCell = formattedRow[i].as<std::string>();
     rowView.append(formattedCell);
-    int padding = table.columnWidth(i) - formattedCell.size() + columnSpacing;
+    int padding = table.columnWidth(columns[i]) - formattedCell.size() +
+	columnSpacing;
     rowView.append(padding, ' ');
   }
   return rowView;
 }
+
+void TableView::resize(WINDOW* window) {
+  this->window = window;
+  getmaxyx(window, height, width);
+  height -= 2;
+  drawnHeaders.clear(); // The new window is blank
+
+  // Keep the cursor's row on screen, and the screen filled if there are enough
+  // rows to fill it
+  int rowsRemaining = table.length() - 1;
+  int viewSize = height > rowsRemaining ? rowsRemaining : height;
+  if (viewSize < 1) {
+    // A table without rows, or a window too short to show any, has nothing to
+    // keep on screen
+    head = 1;
+    tail = 1;
+  } else {
+    int cursor = std::min(index, table.length() - 1);
+    head = std::clamp(head, cursor - viewSize + 1, cursor);
+    head = std::max(1, std::min(head, table.length() - viewSize));
+    tail = head + viewSize;
+  }
+
+  // Lines are rendered to the width of the pad, so start over with a new pad.
+  // Rather than rendering a whole block, render just the rows on screen (from
+  // the rendered line cache, since column widths are unaffected)
+  allocatePad();
+  padStart = std::max(1, head - blockRows);
+  int last = head;
+  if (viewSize > 0) last = std::min(head + height, table.length());
+  renderRows(head, last);
+  renderedBegin = head;
+  renderedEnd = last;
+}
+
+void TableView::allocatePad() {
+  // Each block fills at least a screen, so that a single block is rendered
+  // after the pad has been moved to a new position
+  blockRows = std::max(padBlockRows, height);
+  padRows = padBlocks * blockRows;
+  // A pad too large for memory (e.g., on a very wide terminal) is reported
+  // rather than drawn to
+  WINDOW* newPad = newpad(padRows, width);
+  if (newPad == nullptr) {
+    throw std::runtime_error("Error: Could not allocate a pad of " +
+	std::to_string(padRows) + " rows and " + std::to_string(width) +
+	" columns");
+  }
+  pad = {newPad, delwin};
+  padVersions.assign(padRows, 0);
+  highlightedRow = 0;
+}
+
+void TableView::renderRows(int first, int last) {
+  WINDOW* padWindow = pad.get();
+  for (int row = first; row < last; row++) {
+    int line = row - padStart;
+    wmove(padWindow, line, 0);
+    wclrtoeol(padWindow);
+    waddnstr(padWindow, rowView(table[row]).c_str(), width);
+    padVersions[line] = table[row].version();
+    // Rendering replaces the line's attributes along with its text
+    if (row == highlightedRow) highlightedRow = 0;
+  }
+}
+
+void TableView::highlight(int row, int colourPair) {
+  if (row == highlightedRow && colourPair == highlightedPair) return;
+  // Rows outside of the pad have since been erased
+  auto inPad = [this](int row) {
+    return row > 0 && renderedBegin <= row && row < renderedEnd;
+  };
+  if (inPad(highlightedRow)) {
+    mvwchgat(pad.get(), highlightedRow - padStart, 0, -1, A_NORMAL, 0, NULL);
+  }
+  if (inPad(row)) {
+    mvwchgat(pad.get(), row - padStart, 0, -1, A_NORMAL, colourPair, NULL);
+  }
+  highlightedRow = row;
+  highlightedPair = colourPair;
+}
@@ -1,9 +1,11 @@
 #ifndef TABLE_VIEW_H
 #define TABLE_VIEW_H
 
-#include <deque>
 #include <string>
 #include <vector>
+#include <unordered_map>
+#include <memory>
+#include <algorithm>
 #include <stdexcept>
 
 #include "ncurses.h"
@@ -17,8 +19,12 @@ public:
   void scrollUp(); // Bound-checking
   void scrollDown(); // Bound-checking
   int cursorIndex() const;
+  // Moves the cursor straight to the given row, centring it on screen
+  void seek(int row);
   void draw();
   void refresh();
+  // Moves the view to a new (e.g., resized) window
+  void resize(WINDOW* window);
   bool focus = false;
 private:
   Table& table;
@@ -28,10 +34,34 @@ private:
   int height;
   int width;
   std::string formattedHeaders;
-  std::deque<std::string> view;
+  // Rows are rendered into a pad spanning many more rows than fit on screen,
+  // so scrolling only moves the part of the pad that is shown. The pad's
+  // first line holds the row at padStart, and rows are rendered into it a
+  // block at a time as they are scrolled to. TableViews are copied, so the pad
+  // is shared between copies and deleted along with the last of them
+  std::shared_ptr<WINDOW> pad;
+  int padStart = 1;
+  // The range of rows rendered into the pad
+  int renderedBegin = 1;
+  int renderedEnd = 1;
+  int blockRows;
+  int padRows;
+  std::vector<Row::Version> padVersions; // Of the row on each pad line
+  int padWidthVersion = -1;
+  int highlightedRow = 0; // Header row denotes that no row is highlighted
+  int highlightedPair = 0;
   int head = 1;
   int tail = 1;
-  std::string rowView(Row const& row);
+  // Rendered lines keyed by row version, valid for the column widths of the
+  // given width version
+  std::unordered_map<Row::Version, std::string> lines;
+  int linesWidthVersion = -1;
+  int headersWidthVersion = -1;
+  std::string drawnHeaders;
+  std::string const& rowView(Row const& row);
+  void renderRows(int first, int last);
+  void allocatePad();
+  void highlight(int row, int colourPair);
 };
 
 #endif
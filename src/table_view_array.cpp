@@ -1,24 +1,11 @@
 #include "table_view_array.hpp"
 
 TableViewArray::TableViewArray(TableArray& tables, WINDOW* window) :
-    tables{tables} {
-  // Allocate screen space for each TableView
-  int height;
-  int width;
-  getmaxyx(window, height, width);
-  int subWidth = (int) width / tables.size();
-
+    window{window}, tables{tables} {
+  layout();
   for (int i = 0; i < tables.size(); i++) {
-    WINDOW* border = derwin(window, height, subWidth, 0, subWidth * i);
-    WINDOW* content = derwin(border, height - 2, subWidth - 2, 1, 1);
-    TableView tableView{tables[i], content};
-
-    box(border, 0, 0); // Use default border characters
-    wrefresh(border);
+    TableView tableView{tables[i], contents[i]};
     tableView.draw();
-    
-    borders.push_back(border);
-    contents.push_back(content);
     tableViews.push_back(tableView);
 
     indices.push_back(i);
@@ -39,6 +26,15 @@ TableViewArray::~TableViewArray() {
 }
 
 void TableViewArray::scrollUp() {
+  // With a filter, scrolling skips straight to the previous matching row. Past
+  // the first one the filter is dropped and scrolling carries on through
+  // every row
+  if (activeFilter != ALL) {
+    if (seekMatch(UP, false)) return;
+    beep();
+    filter(ALL);
+  }
+
   int prevFocusedIndex = focusedIndex;
   focusedIndex = reverseFocus();
 
@@ -110,6 +106,14 @@ void TableViewArray::scrollUp() {
 }
 
 void TableViewArray::scrollDown() {
+  // Likewise past the last match, so that the row just recorded is left
+  // behind rather than recorded again
+  if (activeFilter != ALL) {
+    if (seekMatch(DOWN, false)) return;
+    beep();
+    filter(ALL);
+  }
+
   int prevFocusedIndex = focusedIndex;
   // Look forward in currently focused table
   focusedIndex = forwardFocus();
@@ -176,11 +180,74 @@ TableView& TableViewArray::focusedTableView() {
   return tableViews[focusedIndex];
 }
 
+int TableViewArray::focusedTableIndex() const { return focusedIndex; }
+
+TableArray& TableViewArray::tableArray() { return tables; }
+
+void TableViewArray::seek(int table, int row) {
+  // Scrolling down to the row would have traversed every row dated before it,
+  // along with those dated the same in tables to its left (see forwardFocus),
+  // leaving each of the other tables' cursors on their first untraversed row.
+  // Since rows are sorted by date, those cursors are found by binary search
+  Table const& target = tables[table];
+  auto date = target.getDate(target.cbegin() + row);
+  for (int i : indices) {
+    int cursor = row;
+    if (i != table) {
+      Table const& other = tables[i];
+      auto rows = std::views::iota(1, other.length());
+      auto untraversed = std::ranges::partition_point(rows, [&](int row) {
+	auto otherDate = other.getDate(other.cbegin() + row);
+	return i < table ? otherDate <= date : otherDate < date;
+      });
+      cursor = 1 + (untraversed - rows.begin());
+    }
+    tableViews[i].seek(cursor);
+    tableViews[i].focus = i == table;
+    cursorAtHead[i] = cursor == 1;
+    outstandingScrolls[i] = i != table && cursor > 1;
+  }
+  focusedIndex = table;
+  prevScroll = DOWN;
+  for (auto& tableView : tableViews) {
+    tableView.refresh(); // Rows may have been edited without being drawn
+    tableView.draw();
+  }
+}
+
+bool TableViewArray::filter(Filter kind, Amount threshold) {
+  activeFilter = kind;
+  filterThreshold = threshold;
+  rowsAbove.assign(tables.size(), RowSet{});
+  rowsAboveVersions.assign(tables.size(), -1);
+  if (kind == ALL) return true;
+  if (seekMatch(DOWN, true) || seekMatch(UP, false)) return true;
+  activeFilter = ALL; // There are no rows to restrict scrolling to
+  return false;
+}
+
 void TableViewArray::redrawFocusedView() { 
   tableViews[focusedIndex].refresh();
   tableViews[focusedIndex].draw();
 }
 
+void TableViewArray::resize(int height, int width) {
+  // The border and content windows are subwindows, which ncurses can't move
+  // along with their parent, so they are replaced
+  for (auto content : contents) delwin(content);
+  for (auto border : borders) delwin(border);
+  contents.clear();
+  borders.clear();
+  wresize(window, height, width);
+  werase(window);
+  wnoutrefresh(window);
+  layout();
+  for (int i = 0; i < tableViews.size(); i++) {
+    tableViews[i].resize(contents[i]);
+    tableViews[i].draw();
+  }
+}
+
 // TODO: sort first by date and then by table view order (e.g., if all
 // forward/reverse dates across all tables are equal, then prioritise focusing
 // on table in left-to-right/right-to-left order)
@@ -280,6 +347,88 @@ std::chrono::year_month_day TableViewArray::reverseDate(int tableIndex) const {
   }
 };
 
+void TableViewArray::layout() {
+  // Allocate screen space for each TableView
+  int height;
+  int width;
+  getmaxyx(window, height, width);
+  int subWidth = (int) width / tables.size();
+
+  for (int i = 0; i < tables.size(); i++) {
+    WINDOW* border = derwin(window, height, subWidth, 0, subWidth * i);
+    WINDOW* content = derwin(border, height - 2, subWidth - 2, 1, 1);
+    box(border, 0, 0); // Use default border characters
+    wnoutrefresh(border);
+    borders.push_back(border);
+    contents.push_back(content);
+  }
+}
+
+RowSet const& TableViewArray::matchingRows(int tableIndex) {
+  Table& table = tables[tableIndex];
+  switch (activeFilter) {
+    case DEBITS:
+      return table.debitRows();
+    case CREDITS:
+      return table.creditRows();
+    case ABOVE:
+      // Splitting a row changes amounts, so find the rows again if the table's
+      // contents have changed
+      if (rowsAboveVersions[tableIndex] != table.contentVersion()) {
+	rowsAbove[tableIndex] = table.rowsAbove(filterThreshold);
+	rowsAboveVersions[tableIndex] = table.contentVersion();
+      }
+      return rowsAbove[tableIndex];
+    default:
+      return table.uncategorizedRows();
+  }
+}
+
+bool TableViewArray::seekMatch(ScrollDirection direction, bool inclusive) {
+  Table const& focused = tables[focusedIndex];
+  int cursor = tableViews[focusedIndex].cursorIndex();
+  auto date = focused.getDate(focused.cbegin() + std::min(cursor,
+	focused.length() - 1));
+
+  // Find the nearest matching row in each table in the direction of the
+  // scroll, then take the nearest of those in date order (see seek)
+  bool found = false;
+  std::tuple<std::chrono::year_month_day, int, int> nearest;
+  for (int i : indices) {
+    Table const& table = tables[i];
+    RowSet const& matching = matchingRows(i);
+    int row;
+    if (i == focusedIndex) {
+      if (direction == DOWN) {
+	row = inclusive ? cursor : cursor + 1;
+      } else {
+	row = inclusive ? cursor : cursor - 1;
+      }
+    } else {
+      // The first of the table's rows ordered after the cursor's row
+      auto rows = std::views::iota(1, table.length());
+      auto after = std::ranges::partition_point(rows, [&](int row) {
+	auto rowDate = table.getDate(table.cbegin() + row);
+	return rowDate < date || (rowDate == date && i < focusedIndex);
+      });
+      row = 1 + (after - rows.begin());
+      if (direction == UP) row--;
+    }
+    row = direction == DOWN ? matching.next(row) : matching.previous(row);
+    // The header row is never matched
+    if (row < 1 || row >= table.length()) continue;
+
+    std::tuple candidate{table.getDate(table.cbegin() + row), i, row};
+    bool nearer = direction == DOWN ? candidate < nearest : candidate >
+	nearest;
+    if (!found || nearer) nearest = candidate;
+    found = true;
+  }
+  if (!found) return false;
+  seek(std::get<1>(nearest), std::get<2>(nearest));
+  return true;
+}
+
 bool TableViewArray::cursorInBounds(int tableIndex) const {
   auto cursorIndex = tableViews[tableIndex].cursorIndex();
   auto length = tables[tableIndex].length();
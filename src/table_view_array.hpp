@@ -4,6 +4,8 @@
 #include <vector>
 #include <algorithm>
 #include <chrono>
+#include <ranges>
+#include <tuple>
 
 #include <ncurses.h>
 
@@ -13,6 +15,7 @@
 
 class TableViewArray {
 public:
+  enum Filter {ALL, UNCATEGORIZED, DEBITS, CREDITS, ABOVE};
   TableViewArray(TableArray& tables, WINDOW* window);
   ~TableViewArray();
   // TODO: automatically detect and merge entries from separate accounts
@@ -21,9 +24,21 @@ public:
   void scrollDown(); // Bound-checking
   Table& focusedTable();
   TableView& focusedTableView();
+  int focusedTableIndex() const;
+  TableArray& tableArray();
+  // Focuses the given row of the given table directly, leaving every table as
+  // though it had been scrolled down to that row
+  void seek(int table, int row);
+  // Restricts scrolling to the rows matching the filter, moving to the first
+  // such row from the cursor on. If no rows match, the filter is removed and
+  // false is returned
+  bool filter(Filter kind, Amount threshold = 0);
   void redrawFocusedView();
+  // Fits the table views to the window's new size
+  void resize(int height, int width);
 private:
   enum ScrollDirection {UP, DOWN};
+  WINDOW* window;
   std::vector<WINDOW*> borders;
   std::vector<WINDOW*> contents;
   TableArray& tables;
@@ -45,6 +60,15 @@ private:
   std::chrono::year_month_day reverseDate(int tableIndex) const;
   std::chrono::year_month_day forwardDate(int tableIndex) const;
   bool cursorInBounds(int tableIndex) const;
+  void layout();
+  Filter activeFilter = ALL;
+  Amount filterThreshold = 0;
+  // Rows above the threshold of each table, and the content version of the
+  // table they were found for
+  std::vector<RowSet> rowsAbove;
+  std::vector<int> rowsAboveVersions;
+  RowSet const& matchingRows(int tableIndex);
+  bool seekMatch(ScrollDirection direction, bool inclusive);
 };
 
 #endif
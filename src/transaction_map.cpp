@@ -1,66 +1,202 @@
 #include "transaction_map.hpp"
 
-TransactionMap::TransactionMap(std::string mappingFile) {
-  if (std::filesystem::exists(mappingFile)) {
-    map = toml::parse_file(mappingFile);
+namespace {
+  constexpr std::string lockSuffix = ".lock";
+  constexpr std::string temporarySuffix = ".tmp";
+}
+
+TransactionMap::TransactionMap(std::string mappingFile) :
+    mappingFile{mappingFile} {
+  MemoryStats::Tag tag{MemoryStats::TRANSACTION_MAP};
+  // Writers replace the mapping file atomically (see write), so the file can be
+  // read here without taking the lock; we will only ever observe either the
+  // previous or the next complete version of it. The version is recorded
+  // before parsing so that a write racing with the parse is detected later
+  loaded = version(mappingFile);
+  if (loaded.exists) {
+    map = parse(mappingFile);
   }
-  // Open ofstream after parsing file, otherwise contents will be erased/lost
-  out = std::ofstream{mappingFile};
+}
+
+TransactionMap::TransactionMap(TransactionMap&& other) {
+  std::swap(mappingFile, other.mappingFile);
+  std::swap(loaded, other.loaded);
+  std::swap(map, other.map);
+  std::swap(deltas, other.deltas);
 }
 
 TransactionMap& TransactionMap::operator=(TransactionMap other) {
+  std::swap(mappingFile, other.mappingFile);
+  std::swap(loaded, other.loaded);
   std::swap(map, other.map);
-  std::swap(out, other.out);
+  std::swap(deltas, other.deltas);
   return *this;
 }
 
-TransactionMap::~TransactionMap() { out << map; }
-
-void TransactionMap::addRelation(std::string payee, std::string destination) {
-  // By default, create a new table containing a single destination key with an
-  // initial tally of one and attempt to insert it into the top level map at a
-  // new "payee" node
-  toml::table newDestinationTally{{destination, 1}};
-  bool payeeExists = !map.insert(payee, newDestinationTally).second;
-  if (payeeExists) {
-    // If that "payee" node already exists (will cause the insertion to fail),
-    // then attempt to insert the destination key with an initial tally of one
-    // under the "payee" node
-    toml::table* payeeTable = map[payee].as_table();
-    bool destinationExists = !payeeTable->insert(destination, 1).second;
-    if (destinationExists) {
-      // If that destination key is also already present in the "payee" node's
-      // table, then simply retrieve its value and increment it
-      auto tally = payeeTable->get_as<int64_t>(destination);
-      payeeTable->insert_or_assign(destination, ++(**tally));
+TransactionMap::~TransactionMap() {
+  // Default-constructed and moved-from maps have no file to write to
+  if (mappingFile.empty()) return;
+  try {
+    write();
+  } catch (std::exception const& e) {
+    // TODO: log error properly
+    std::cerr << "Error: Unable to write transaction mapping file - ";
+    std::cerr << e.what() << '\n';
+  }
+}
+
+void TransactionMap::addRelation(Symbol payee, Symbol destination) {
+  MemoryStats::Tag tag{MemoryStats::TRANSACTION_MAP};
+  // Symbols hash as integers and default-construct a zero tally, so a single
+  // lookup either creates or increments the destination's tally
+  map[payee][destination]++;
+  // Keep a separate record of this session's tallies so that they can be
+  // merged into whatever version of the file exists when the map is written
+  deltas[payee][destination]++;
+}
+
+void TransactionMap::removeRelation(Symbol payee, Symbol destination) {
+  // Tallies that drop to zero are erased so that the maps don't accumulate
+  // empty entries, and so that a session whose relations have all been
+  // removed again has nothing to write
+  for (Tallies* tallies : {&map, &deltas}) {
+    auto& payeeTallies = (*tallies)[payee];
+    if (--payeeTallies[destination] == 0) payeeTallies.erase(destination);
+    if (payeeTallies.empty()) tallies->erase(payee);
+  }
+}
+
+Symbol TransactionMap::getCounterparty(Symbol payee) const {
+  Symbol result;
+  auto payeeTallies = map.find(payee);
+  if (payeeTallies != map.end()) {
+    // If the payee exists in the map, then find the destination with the
+    // largest tally, so long as it's greater than zero. Ties go to the name
+    // that sorts first so the result doesn't depend on hash order
+    int64_t largest = 0;
+    for (auto const& [destination, tally] : payeeTallies->second) {
+      if (tally > largest
+	  || (tally == largest && destination.str() < result.str())) {
+	largest = tally;
+	result = destination;
+      }
     }
   }
+  return result;
 }
 
-std::string TransactionMap::getCounterparty(std::string payee) {
-  std::string result;
-  // Retrieve the table nested under "payee" and check that it exists
-  auto* payeeTable = map.get_as<toml::table>(payee);
-  if (payeeTable != nullptr) {
-    // If the payee exists in the map, then find the pair with the largest tally
-    auto compare = [](auto const& a, auto const& b) {
-      int tallyA = a.second.value_or(0);
-      int tallyB = b.second.value_or(0);
-      return tallyA < tallyB;
-      /*
-       * See
-       * https://stackoverflow.com/questions/77144003/use-of-template-keyword-before-dependent-template-name
-       * for why the following form cannot be used:
-       *
-       * return a.second.value_or<int64_t>(0) < b.second.value_or<int64_t>(0);
-       */
-    };
-    toml::table_iterator pair;
-    pair = std::max_element(payeeTable->begin(), payeeTable->end(), compare);
-    // If the largest tally isn't greater than zero, then return an empty result
-    if (pair->second.value_or<int64_t>(0) > 0) {
-      result = pair->first.str();
+std::unordered_map<Symbol, int64_t> TransactionMap::usage() const {
+  std::unordered_map<Symbol, int64_t> totals;
+  for (auto const& [payee, destinations] : map) {
+    for (auto const& [destination, tally] : destinations) {
+      totals[destination] += tally;
     }
   }
+  return totals;
+}
+
+bool TransactionMap::Version::operator==(Version const& other) const {
+  return exists == other.exists && inode == other.inode && size == other.size
+      && modified.tv_sec == other.modified.tv_sec
+      && modified.tv_nsec == other.modified.tv_nsec;
+}
+
+TransactionMap::Version TransactionMap::version(std::string const& file) {
+  Version result;
+  struct stat status;
+  if (stat(file.c_str(), &status) == 0) {
+    result = {
+      .exists = true,
+      .inode = status.st_ino,
+      .size = status.st_size,
+      .modified = status.st_mtim
+    };
+  }
   return result;
 }
+
+TransactionMap::Tallies TransactionMap::parse(std::string const& file) {
+  Tallies tallies;
+  toml::table table = toml::parse_file(file);
+  for (auto const& [payee, destinations] : table) {
+    auto* destinationTable = destinations.as_table();
+    if (destinationTable == nullptr) continue;
+    auto& payeeTallies = tallies[Symbol{payee.str()}];
+    for (auto const& [destination, tally] : *destinationTable) {
+      payeeTallies[Symbol{destination.str()}] = tally.value_or<int64_t>(0);
+    }
+  }
+  return tallies;
+}
+
+toml::table TransactionMap::serialize(Tallies const& tallies) {
+  toml::table table;
+  for (auto const& [payee, destinations] : tallies) {
+    toml::table destinationTable;
+    for (auto const& [destination, tally] : destinations) {
+      // Tallies that have been cancelled out carry no information
+      if (tally > 0) destinationTable.insert(destination.str(), tally);
+    }
+    if (!destinationTable.empty()) {
+      table.insert(payee.str(), std::move(destinationTable));
+    }
+  }
+  return table;
+}
+
+void TransactionMap::write() {
+  // Nothing recorded this session, so there is nothing to merge or write
+  if (deltas.empty()) return;
+
+  // Serialize writers with an advisory lock on a separate lock file. The
+  // mapping file itself can't be locked since it is replaced (i.e., its inode
+  // changes) on every write. The lock is released when the descriptor is closed
+  std::string lockFile = mappingFile + lockSuffix;
+  int lock = open(lockFile.c_str(), O_RDWR | O_CREAT, 0644);
+  if (lock < 0) {
+    throw std::runtime_error("Could not open lock file " + lockFile);
+  }
+  struct flock request = {};
+  request.l_type = F_WRLCK;
+  request.l_whence = SEEK_SET;
+  while (fcntl(lock, F_SETLKW, &request) < 0) {
+    if (errno != EINTR) {
+      close(lock);
+      throw std::runtime_error("Could not lock " + lockFile);
+    }
+  }
+
+  try {
+    // If another process has written the file since we loaded it, then re-read
+    // it and merge this session's tallies into its contents rather than
+    // clobbering them with our (stale) copy of the map. Otherwise, our copy
+    // already holds the merged result
+    if (!(version(mappingFile) == loaded)) {
+      map.clear();
+      if (std::filesystem::exists(mappingFile)) map = parse(mappingFile);
+      for (auto const& [payee, destinations] : deltas) {
+	for (auto const& [destination, delta] : destinations) {
+	  map[payee][destination] += delta;
+	}
+      }
+    }
+
+    // Write to a temporary file and rename it over the mapping file so that
+    // readers never observe a partially written map
+    std::string temporaryFile = mappingFile + temporarySuffix;
+    std::ofstream out{temporaryFile};
+    out << serialize(map);
+    out.close();
+    if (out.fail()) {
+      throw std::runtime_error("Could not write " + temporaryFile);
+    }
+    std::filesystem::rename(temporaryFile, mappingFile);
+  } catch (...) {
+    close(lock);
+    throw;
+  }
+
+  loaded = version(mappingFile);
+  deltas.clear();
+  close(lock);
+}
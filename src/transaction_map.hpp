@@ -5,20 +5,58 @@
 #include <filesystem>
 #include <fstream>
 #include <algorithm>
+#include <iostream>
+#include <cerrno>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
 #include "toml.hpp"
+#include "symbol.hpp"
+#include "memory_stats.hpp"
 
 class TransactionMap {
 public:
   TransactionMap(std::string mappingFile);
   TransactionMap() = default;
+  // The destructor writes this session's tallies, so a copy would write them a
+  // second time. Moving leaves the moved-from map without a file to write to
+  TransactionMap(TransactionMap const&) = delete;
+  TransactionMap(TransactionMap&& other);
   TransactionMap& operator=(TransactionMap other);
   ~TransactionMap();
-  void addRelation(std::string payee, std::string destination);
-  std::string getCounterparty(std::string payee);
+  void addRelation(Symbol payee, Symbol destination);
+  // Reverts an addRelation
+  void removeRelation(Symbol payee, Symbol destination);
+  Symbol getCounterparty(Symbol payee) const;
+  // Total tallies of each destination across all payees
+  std::unordered_map<Symbol, int64_t> usage() const;
+  // Merges this session's tallies into the mapping file. The map is written on
+  // destruction regardless, but writing it sooner tells the caller when the
+  // tallies are safe
+  void write();
 private:
-  toml::table map;
-  std::ofstream out;
+  // Destination tallies keyed by payee
+  typedef std::unordered_map<Symbol, std::unordered_map<Symbol, int64_t>>
+      Tallies;
+  // Identifies a particular version of the mapping file on disk so that writes
+  // made by other processes since it was loaded can be detected
+  struct Version {
+    bool exists = false;
+    ino_t inode = 0;
+    off_t size = 0;
+    struct timespec modified = {};
+    bool operator==(Version const& other) const;
+  };
+  std::string mappingFile;
+  Version loaded;
+  Tallies map; // Tallies loaded from file plus those recorded this session
+  Tallies deltas; // Only the tallies recorded this session
+  static Version version(std::string const& file);
+  static Tallies parse(std::string const& file);
+  static toml::table serialize(Tallies const& tallies);
 };
 
 #endif
@@ -0,0 +1,205 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <set>
+#include <chrono>
+#include <cstdlib>
+#include <cstdio>
+#include <filesystem>
+#include <optional>
+
+#include "toml.hpp"
+#include "corpus.hpp"
+
+// Writes synthetic statements along with everything needed to reconcile them:
+// a config with an [[accounts]] entry per statement, a Ledger accounts file and
+// a transaction map holding a categorization history of the statements' payees.
+// For example, for a session over a million rows of every layout:
+//
+//   reconcile.generate --rows 1000000 --quoted --crlf generated
+//   cd generated && reconcile.debug statement_*.csv
+
+namespace {
+  constexpr char const* configFile = "config.toml";
+  constexpr char const* accountsFile = "accounts.dat";
+  constexpr char const* mapFile = "transaction_map.toml";
+  constexpr char const* ledgerFile = "ledger_dat";
+  constexpr char const* globalDateFormat = "%Y-%m-%d %a";
+
+  struct Options {
+    Corpus::Options corpus;
+    std::vector<Corpus::Layout> layouts; // Every layout if empty
+    std::string directory = ".";
+  };
+
+  std::optional<Corpus::Layout> parseLayout(std::string_view name) {
+    for (int i = 0; i < Corpus::LAYOUT_COUNT; i++) {
+      if (Corpus::layoutName(Corpus::Layout(i)) == name) {
+	return Corpus::Layout(i);
+      }
+    }
+    return std::nullopt;
+  }
+
+  bool parseDate(std::string const& date, std::chrono::year_month_day& day) {
+    int year;
+    unsigned month, dayOfMonth;
+    if (std::sscanf(date.c_str(), "%d-%u-%u", &year, &month, &dayOfMonth) !=
+	3) return false;
+    day = std::chrono::year{year} / month / dayOfMonth;
+    return day.ok();
+  }
+
+  toml::array toArray(std::vector<int> const& values) {
+    toml::array array;
+    for (int value : values) array.push_back(value);
+    return array;
+  }
+
+  toml::table accountEntry(Descriptor const& descriptor) {
+    return toml::table{
+      {"identifier", descriptor.identifier},
+      {"ledger_source", descriptor.ledgerSource},
+      {"normal_balance", descriptor.normalBalance == Descriptor::DEBIT ? "DR" :
+	"CR"},
+      {"date_column", descriptor.dateColumn},
+      {"date_format", descriptor.dateFormat},
+      {"debit_column", descriptor.debitColumn},
+      {"debit_format", descriptor.debitFormat},
+      {"credit_column", descriptor.creditColumn},
+      {"credit_format", descriptor.creditFormat},
+      {"payee_columns", toArray(descriptor.payeeColumns)},
+      {"display_columns", toArray(descriptor.displayColumns)}
+    };
+  }
+
+  void write(std::filesystem::path const& file, auto const& contents) {
+    std::ofstream out{file};
+    out << contents << '\n';
+    out.close();
+    if (out.fail()) {
+      throw std::runtime_error("Error: Could not write " + file.string());
+    }
+  }
+}
+
+int main(int argc, char* argv[]) {
+  Options options;
+  bool usage = false;
+  for (int i = 1; i < argc; i++) {
+    std::string_view option{argv[i]};
+    bool hasValue = i + 1 < argc;
+    if (option == "--rows" && hasValue) {
+      options.corpus.rows = std::atoi(argv[++i]);
+    } else if (option == "--seed" && hasValue) {
+      options.corpus.seed = std::strtoul(argv[++i], nullptr, 10);
+    } else if (option == "--zipf" && hasValue) {
+      options.corpus.zipfExponent = std::atof(argv[++i]);
+    } else if (option == "--start" && hasValue) {
+      usage |= !parseDate(argv[++i], options.corpus.firstDate);
+    } else if (option == "--days" && hasValue) {
+      options.corpus.days = std::atoi(argv[++i]);
+    } else if (option == "--layout" && hasValue) {
+      std::optional<Corpus::Layout> layout = parseLayout(argv[++i]);
+      if (layout.has_value()) {
+	options.layouts.push_back(*layout);
+      } else {
+	usage = true;
+      }
+    } else if (option == "--quoted") {
+      options.corpus.quoted = true;
+    } else if (option == "--crlf") {
+      options.corpus.crlf = true;
+    } else if (i == argc - 1 && !option.starts_with("--")) {
+      options.directory = option;
+    } else {
+      usage = true;
+    }
+  }
+  if (usage || options.corpus.rows < 0) {
+    std::cerr << "Usage: reconcile.generate [--rows rows] [--seed seed] ";
+    std::cerr << "[--zipf exponent] [--start YYYY-MM-DD] [--days days] ";
+    std::cerr << "[--layout chequing|credit_card|savings]... [--quoted] ";
+    std::cerr << "[--crlf] [directory]\n";
+    return 1;
+  }
+  if (options.layouts.empty()) {
+    for (int i = 0; i < Corpus::LAYOUT_COUNT; i++) {
+      options.layouts.push_back(Corpus::Layout(i));
+    }
+  }
+
+  try {
+    std::filesystem::path directory{options.directory};
+    std::filesystem::create_directories(directory);
+
+    toml::table config{
+      {"date_format", globalDateFormat},
+      {"ledger_accounts", accountsFile},
+      {"append_new_accounts", false},
+      {"trace_latency", false},
+      {"output", toml::table{
+	{"file", ledgerFile},
+	{"format", toml::table{
+	  {"locale", "en_US.UTF-8"},
+	  {"indentation", 4},
+	  {"margin", 8}
+	}}
+      }}
+    };
+    toml::array accountEntries;
+    // Sorted so that the files are the same from run to run
+    std::set<std::string> accounts;
+    std::map<std::string, std::map<std::string, std::int64_t>> tallies;
+
+    for (Corpus::Layout layout : options.layouts) {
+      options.corpus.layout = layout;
+      Corpus corpus{options.corpus};
+      std::string statement = "statement_" + Corpus::layoutName(layout) +
+	  ".csv";
+      corpus.write(directory / statement);
+      std::cerr << "Info: Wrote " << corpus.lines().size() << " rows to ";
+      std::cerr << statement << '\n';
+
+      Descriptor const& descriptor = corpus.descriptor();
+      accountEntries.push_back(accountEntry(descriptor));
+      accounts.insert(descriptor.ledgerSource);
+      accounts.insert(corpus.accounts().begin(), corpus.accounts().end());
+
+      // The history holds every row's categorization once over, as though the
+      // statement had been reconciled before. A payee spread over several
+      // columns is keyed by the columns' values joined with spaces (see
+      // Table::getPayee). Generated payees are always in the first column
+      std::string padding(descriptor.payeeColumns.size() - 1, ' ');
+      for (int payee : corpus.rowPayees()) {
+	tallies[corpus.payees()[payee] + padding][corpus.account(payee)]++;
+      }
+    }
+    config.insert("accounts", std::move(accountEntries));
+
+    std::string accountDirectives;
+    for (std::string const& account : accounts) {
+      accountDirectives += "account " + account + '\n';
+    }
+    toml::table map;
+    for (auto const& [payee, destinations] : tallies) {
+      toml::table destinationTable;
+      for (auto const& [destination, tally] : destinations) {
+	destinationTable.insert(destination, tally);
+      }
+      map.insert(payee, std::move(destinationTable));
+    }
+
+    write(directory / configFile, config);
+    if (!accountDirectives.empty()) accountDirectives.pop_back();
+    write(directory / accountsFile, accountDirectives);
+    write(directory / mapFile, map);
+  } catch (std::exception const& e) {
+    std::cerr << e.what() << '\n';
+    return 1;
+  }
+  return 0;
+}